@@ -0,0 +1,29 @@
+#!/bin/sh
+#
+# Build the host benchmarks into bench/out, the memory pool benchmark
+# once per placement policy, and the queue copy benchmark. The kernel
+# sources are compiled against the host port in bench/port, no
+# scheduler is started.
+#
+#   CC       compiler, defaults to cc
+#   CFLAGS   extra flags, e.g. -DOSPORT_MEM_COMPACT=1
+#
+set -e
+
+cd "$(dirname "$0")"
+CC=${CC:-cc}
+FLAGS="-std=c99 -O2 -Wall -Wextra -Iport"
+POOL="../source/memory.c ../source/list.c ../source/util.c stubs.c"
+
+mkdir -p out
+
+for policy in next_fit first_fit best_fit
+do
+	POLICY=$(echo "$policy" | tr 'a-z' 'A-Z')
+	$CC $FLAGS -DOSPORT_MEM_POLICY=OSPORT_MEM_$POLICY $CFLAGS \
+		$POOL mpool_bench.c -o out/mpool_bench_$policy
+done
+
+$CC $FLAGS $CFLAGS ../source/*.c copy_bench.c copy_ref.c -o out/copy_bench
+
+echo "built bench/out/mpool_bench_{next_fit,first_fit,best_fit} and bench/out/copy_bench"
@@ -0,0 +1,223 @@
+/** ************************************************************************
+ * @file copy_bench.c
+ * @brief Queue copy benchmark, runs on the host
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../rtos_module.h"
+#include "copy_ref.h"
+
+/*
+ * Benchmark parameters
+ */
+#define BENCH_QUEUE_SIZE  (4096)
+#define BENCH_BATCH       (1000)
+#define BENCH_NUM_BATCHES (200)
+#define BENCH_NUM_CHECKS  (200000)
+
+/*
+ * Required by the host port, the scheduler is never started
+ */
+void bench_idle( void )
+{
+	abort();
+}
+
+/*
+ * Monotonic time in nanoseconds
+ */
+static unsigned long bench_now( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (unsigned long)ts.tv_sec * 1000000000UL + (unsigned long)ts.tv_nsec;
+}
+
+/*
+ * Random writes and reads of random sizes at random source and
+ * destination alignments, checked against the reference ring
+ */
+static int bench_verify( void )
+{
+	static const uint_t sizes[] = { 1, 7, 61, 64, 256 };
+	static byte_t q_mem[256 + sizeof(handle_t)];
+	static byte_t ref_mem[256];
+	static byte_t src[300], out[300], ref_out[300];
+	queue_cblk_t q;
+	bench_ref_t ref;
+	uint_t i, j, k, n, src_off, dst_off;
+	int ret = 0;
+
+	for( k = 0; (ret == 0) && (k < sizeof(sizes) / sizeof(sizes[0])); k++ )
+	{
+		/* also misalign the queue buffer */
+		queue_init( &q, q_mem + k % sizeof(handle_t), sizes[k] );
+		ref.p_buffer = ref_mem;
+		ref.size = sizes[k];
+		ref.read = 0;
+		ref.write = 0;
+		ref.reserve = 0;
+		ref.acquire = 0;
+		ref.num_reserved = 0;
+		ref.num_acquired = 0;
+
+		for( i = 0; (ret == 0) && (i < BENCH_NUM_CHECKS); i++ )
+		{
+			src_off = (uint_t)(rand() % (int)sizeof(handle_t));
+			dst_off = (uint_t)(rand() % (int)sizeof(handle_t));
+
+			if( rand() % 2 == 0 )
+			{
+				/* the queue keeps one byte free, as the reference does */
+				n = (uint_t)(rand() % (int)sizes[k]);
+				if( n > sizes[k] - 1 - bench_ref_used(&ref) )
+					n = sizes[k] - 1 - bench_ref_used(&ref);
+
+				for( j = 0; j < n; j++ )
+					src[src_off + j] = (byte_t)rand();
+
+				queue_write( &q, src + src_off, n );
+				bench_ref_write( &ref, src + src_off, n );
+			}
+			else
+			{
+				n = (uint_t)(rand() % (int)sizes[k]);
+				if( n > bench_ref_used(&ref) )
+					n = bench_ref_used(&ref);
+
+				queue_read( &q, out + dst_off, n );
+				bench_ref_read( &ref, ref_out, n );
+
+				if( memcmp(out + dst_off, ref_out, n) != 0 )
+					ret = -1;
+			}
+
+			if( (q.read != ref.read) || (q.write != ref.write) )
+				ret = -1;
+		}
+
+		if( ret != 0 )
+			fprintf( stderr, "mismatch, queue size %lu, operation %lu\n",
+					(unsigned long)sizes[k], (unsigned long)i );
+	}
+
+	return ret;
+}
+
+/*
+ * Time one write and one read of a message size, the copy time
+ * is what the senders and receivers spend with interrupts disabled
+ */
+static void bench_run( uint_t size )
+{
+	static handle_t q_mem[BENCH_QUEUE_SIZE / sizeof(handle_t)];
+	static handle_t ref_mem[BENCH_QUEUE_SIZE / sizeof(handle_t)];
+	static handle_t msg[BENCH_QUEUE_SIZE / sizeof(handle_t)];
+	queue_cblk_t q;
+	bench_ref_t ref;
+	unsigned long before_total = 0, after_total = 0;
+	unsigned long before_max = 0, after_max = 0;
+	unsigned long start, end, t;
+	uint_t batch, i;
+
+	memset( msg, 0x5A, sizeof(msg) );
+	queue_init( &q, q_mem, BENCH_QUEUE_SIZE );
+	ref.p_buffer = (byte_t*)ref_mem;
+	ref.size = BENCH_QUEUE_SIZE;
+	ref.read = 0;
+	ref.write = 0;
+	ref.reserve = 0;
+	ref.acquire = 0;
+	ref.num_reserved = 0;
+	ref.num_acquired = 0;
+
+	for( batch = 0; batch < BENCH_NUM_BATCHES; batch++ )
+	{
+		/* before, byte loop */
+		start = bench_now();
+		for( i = 0; i < BENCH_BATCH; i++ )
+		{
+			bench_ref_write( &ref, (const byte_t*)msg, size );
+			bench_ref_read( &ref, (byte_t*)msg, size );
+		}
+		end = bench_now();
+
+		t = end - start;
+		before_total += t;
+		if( t > before_max )
+			before_max = t;
+
+		/* after, two util_copy segments */
+		start = bench_now();
+		for( i = 0; i < BENCH_BATCH; i++ )
+		{
+			queue_write( &q, (const byte_t*)msg, size );
+			queue_read( &q, (byte_t*)msg, size );
+		}
+		end = bench_now();
+
+		t = end - start;
+		after_total += t;
+		if( t > after_max )
+			after_max = t;
+	}
+
+	/* mean and worst batch, per message copied in and out */
+	printf( "%6lu  %9.1f %9.1f %8.1f  %9.1f %9.1f %8.1f  %5.2fx\n",
+			(unsigned long)size,
+			(double)before_total / (BENCH_NUM_BATCHES * BENCH_BATCH),
+			(double)before_max / BENCH_BATCH,
+			(double)size * 2 * BENCH_NUM_BATCHES * BENCH_BATCH * 1000.0 / (double)before_total,
+			(double)after_total / (BENCH_NUM_BATCHES * BENCH_BATCH),
+			(double)after_max / BENCH_BATCH,
+			(double)size * 2 * BENCH_NUM_BATCHES * BENCH_BATCH * 1000.0 / (double)after_total,
+			(double)before_total / (double)after_total );
+}
+
+int main( void )
+{
+	static const uint_t sizes[] = { 1, 4, 16, 64, 256, 1024 };
+	uint_t k;
+
+	srand( 1 );
+
+	if( bench_verify() != 0 )
+		return EXIT_FAILURE;
+
+	printf( "queue_write/queue_read match the byte loop reference\n\n" );
+	printf( "                 before (byte loop)            after (util_copy)\n" );
+	printf( "  size    ns/msg  worst ns     MB/s     ns/msg  worst ns     MB/s  speedup\n" );
+
+	for( k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++ )
+		bench_run( sizes[k] );
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+/** ************************************************************************
+ * @file copy_ref.c
+ * @brief Queue copy reference model, runs on the host
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#include "copy_ref.h"
+
+/*
+ * Kept out of copy_bench.c so the compiler cannot inline the reference
+ * into the timing loop, queue_write and queue_read are called across
+ * translation units in the same way
+ */
+void bench_ref_write( bench_ref_t *p_ref, const byte_t *p_data, uint_t size )
+{
+	uint_t counter;
+
+	for( counter = 0; counter < size; counter++ )
+	{
+		p_ref->p_buffer[p_ref->reserve] = p_data[counter];
+
+		if( p_ref->reserve < p_ref->size - 1 )
+			p_ref->reserve++;
+		else
+			p_ref->reserve = 0;
+	}
+
+	if( p_ref->num_reserved == 0 )
+		p_ref->write = p_ref->reserve;
+}
+
+void bench_ref_read( bench_ref_t *p_ref, byte_t *p_data, uint_t size )
+{
+	uint_t counter;
+
+	for( counter = 0; counter < size; counter++ )
+	{
+		p_data[counter] = p_ref->p_buffer[p_ref->acquire];
+
+		if( p_ref->acquire < p_ref->size - 1 )
+			p_ref->acquire++;
+		else
+			p_ref->acquire = 0;
+	}
+
+	if( p_ref->num_acquired == 0 )
+		p_ref->read = p_ref->acquire;
+}
+
+uint_t bench_ref_used( const bench_ref_t *p_ref )
+{
+	if( p_ref->write >= p_ref->read )
+		return p_ref->write - p_ref->read;
+	else
+		return p_ref->size - p_ref->read + p_ref->write;
+}
@@ -0,0 +1,55 @@
+/** ************************************************************************
+ * @file copy_ref.h
+ * @brief Queue copy reference model, runs on the host
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef HD6B81DF1_552A_4962_8698_4CBBEE94CD9D
+#define HD6B81DF1_552A_4962_8698_4CBBEE94CD9D
+
+#include "../rtos_module.h"
+
+/*
+ * Reference ring buffer, copied one byte per iteration with a wrap
+ * branch on every byte, as queue_write and queue_read did before
+ * util_copy. It keeps the reserve and acquire indices the queue has
+ * for spans, so only the copy differs.
+ */
+typedef struct
+{
+	byte_t *p_buffer; /* ring memory  */
+	uint_t size;      /* ring size    */
+	uint_t read;      /* read index   */
+	uint_t write;     /* write index  */
+	uint_t reserve;   /* write index after reserved spans  */
+	uint_t acquire;   /* read index after acquired spans   */
+	uint_t num_reserved; /* reserved spans, always 0 here  */
+	uint_t num_acquired; /* acquired spans, always 0 here  */
+} bench_ref_t;
+
+void bench_ref_write( bench_ref_t *p_ref, const byte_t *p_data, uint_t size );
+void bench_ref_read( bench_ref_t *p_ref, byte_t *p_data, uint_t size );
+uint_t bench_ref_used( const bench_ref_t *p_ref );
+
+#endif
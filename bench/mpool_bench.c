@@ -0,0 +1,485 @@
+/** ************************************************************************
+ * @file mpool_bench.c
+ * @brief Memory pool trace replay benchmark, runs on the host
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../rtos_module.h"
+
+/*
+ * Trace limits
+ */
+#define BENCH_MAX_IDS     (4096)
+#define BENCH_MAX_OPS     (1000000)
+#define BENCH_MAX_POOL    (1024 * 1024)
+
+/*
+ * Trace operation
+ */
+typedef enum
+{
+	BENCH_ALLOC = 0,  /* transient allocation  */
+	BENCH_ALLOC_LONG, /* long-lived allocation */
+	BENCH_FREE        /* free                  */
+} bench_op_type_t;
+
+typedef struct
+{
+	bench_op_type_t type; /* operation               */
+	uint_t id;            /* allocation identifier   */
+	uint_t size;          /* requested size          */
+} bench_op_t;
+
+/*
+ * Per operation samples
+ */
+typedef struct
+{
+	unsigned long *p_ns; /* latencies       */
+	uint_t *p_scan;      /* search lengths  */
+	unsigned long count; /* samples         */
+} bench_samples_t;
+
+static bench_op_t g_ops[BENCH_MAX_OPS];
+static unsigned long g_num_ops;
+static void *g_ptrs[BENCH_MAX_IDS];
+static uint64_t g_pool_mem[BENCH_MAX_POOL / sizeof(uint64_t)];
+
+#if OSPORT_MEM_POLICY == OSPORT_MEM_NEXT_FIT
+#	define BENCH_POLICY_NAME "next fit"
+#elif OSPORT_MEM_POLICY == OSPORT_MEM_FIRST_FIT
+#	define BENCH_POLICY_NAME "first fit"
+#else
+#	define BENCH_POLICY_NAME "best fit"
+#endif
+
+/*
+ * Append an operation to the trace
+ */
+static void bench_push( bench_op_type_t type, uint_t id, uint_t size )
+{
+	if( g_num_ops < BENCH_MAX_OPS )
+	{
+		g_ops[g_num_ops].type = type;
+		g_ops[g_num_ops].id = id;
+		g_ops[g_num_ops].size = size;
+		g_num_ops++;
+	}
+}
+
+/*
+ * Random size in [min, max]
+ */
+static uint_t bench_rand_size( uint_t min, uint_t max )
+{
+	return min + (uint_t)(rand() % (int)(max - min + 1));
+}
+
+/*
+ * Generate a synthetic trace. The generator keeps its own model of the
+ * live set, so every policy replays the same operations; frees of
+ * allocations that failed are skipped during the replay.
+ */
+static int bench_generate( const char *p_name, unsigned long num_ops )
+{
+	static bool_t live[BENCH_MAX_IDS];
+	uint_t id, size, slots = 0;
+	int ret = 0;
+
+	memset( live, 0, sizeof(live) );
+
+	if( strcmp(p_name, "uniform") == 0 )
+		slots = 256;
+	else if( strcmp(p_name, "bimodal") == 0 )
+		slots = 128;
+	else if( strcmp(p_name, "mixed") == 0 )
+		slots = 512;
+	else
+		ret = -1;
+
+	while( (ret == 0) && (g_num_ops < num_ops) )
+	{
+		id = (uint_t)(rand() % (int)slots);
+
+		if( live[id] )
+		{
+			/*
+			 * In the mixed workload, the low eighth of the identifiers
+			 * are stacks and buffers that mostly stay
+			 */
+			if( (slots == 512) && (id < slots / 8) && (rand() % 16 != 0) )
+				continue;
+
+			bench_push( BENCH_FREE, id, 0 );
+			live[id] = false;
+		}
+		else if( slots == 256 )
+		{
+			/* small messages of any size */
+			bench_push( BENCH_ALLOC, id, bench_rand_size(8, 256) );
+			live[id] = true;
+		}
+		else if( slots == 128 )
+		{
+			/* mostly small control blocks, some large buffers */
+			if( rand() % 10 == 0 )
+				size = bench_rand_size( 512, 2048 );
+			else
+				size = bench_rand_size( 8, 32 );
+
+			bench_push( BENCH_ALLOC, id, size );
+			live[id] = true;
+		}
+		else
+		{
+			if( id < slots / 8 )
+				bench_push( BENCH_ALLOC_LONG, id, bench_rand_size(256, 1024) );
+			else
+				bench_push( BENCH_ALLOC, id, bench_rand_size(8, 128) );
+
+			live[id] = true;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Load a recorded trace, one operation per line:
+ *   a <id> <size>   transient allocation
+ *   l <id> <size>   long-lived allocation
+ *   f <id>          free
+ * Empty lines and lines starting with # are ignored.
+ */
+static int bench_load( const char *p_path )
+{
+	FILE *p_file;
+	char line[128];
+	char type;
+	unsigned long id, size;
+	unsigned long line_num = 0;
+	int num, ret = 0;
+
+	p_file = fopen( p_path, "r" );
+	if( p_file == NULL )
+	{
+		fprintf( stderr, "cannot open %s\n", p_path );
+		return -1;
+	}
+
+	while( (ret == 0) && (fgets(line, sizeof(line), p_file) != NULL) )
+	{
+		line_num++;
+
+		if( (line[0] == '#') || (line[0] == '\n') || (line[0] == '\0') )
+			continue;
+
+		size = 0;
+		num = sscanf( line, " %c %lu %lu", &type, &id, &size );
+
+		if( (num < 2) || (id >= BENCH_MAX_IDS) ||
+				((type != 'f') && (num < 3)) )
+		{
+			fprintf( stderr, "%s:%lu: invalid operation\n", p_path, line_num );
+			ret = -1;
+		}
+		else if( type == 'a' )
+			bench_push( BENCH_ALLOC, (uint_t)id, (uint_t)size );
+		else if( type == 'l' )
+			bench_push( BENCH_ALLOC_LONG, (uint_t)id, (uint_t)size );
+		else if( type == 'f' )
+			bench_push( BENCH_FREE, (uint_t)id, 0 );
+		else
+		{
+			fprintf( stderr, "%s:%lu: unknown operation '%c'\n", p_path, line_num, type );
+			ret = -1;
+		}
+	}
+
+	fclose( p_file );
+	return ret;
+}
+
+/*
+ * Monotonic time in nanoseconds
+ */
+static unsigned long bench_now( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (unsigned long)ts.tv_sec * 1000000000UL + (unsigned long)ts.tv_nsec;
+}
+
+static int bench_cmp_ulong( const void *p_a, const void *p_b )
+{
+	unsigned long a = *(const unsigned long*)p_a, b = *(const unsigned long*)p_b;
+	return (a > b) - (a < b);
+}
+
+static int bench_cmp_uint( const void *p_a, const void *p_b )
+{
+	uint_t a = *(const uint_t*)p_a, b = *(const uint_t*)p_b;
+	return (a > b) - (a < b);
+}
+
+/*
+ * Index of a percentile in sorted samples, per mille
+ */
+static unsigned long bench_rank( unsigned long count, unsigned long permille )
+{
+	return (count * permille + 999) / 1000 - 1;
+}
+
+static void bench_report( const char *p_name, bench_samples_t *p_samples, bool_t scan )
+{
+	unsigned long n = p_samples->count;
+
+	if( n == 0 )
+	{
+		printf( "%-6s no samples\n", p_name );
+		return;
+	}
+
+	qsort( p_samples->p_ns, n, sizeof(unsigned long), bench_cmp_ulong );
+	printf( "%-6s ns    p50 %6lu  p90 %6lu  p99 %6lu  p99.9 %6lu  max %6lu\n",
+			p_name,
+			p_samples->p_ns[bench_rank(n, 500)],
+			p_samples->p_ns[bench_rank(n, 900)],
+			p_samples->p_ns[bench_rank(n, 990)],
+			p_samples->p_ns[bench_rank(n, 999)],
+			p_samples->p_ns[n - 1] );
+
+	if( scan )
+	{
+		qsort( p_samples->p_scan, n, sizeof(uint_t), bench_cmp_uint );
+		printf( "%-6s scan  p50 %6lu  p90 %6lu  p99 %6lu  p99.9 %6lu  max %6lu\n",
+				p_name,
+				(unsigned long)p_samples->p_scan[bench_rank(n, 500)],
+				(unsigned long)p_samples->p_scan[bench_rank(n, 900)],
+				(unsigned long)p_samples->p_scan[bench_rank(n, 990)],
+				(unsigned long)p_samples->p_scan[bench_rank(n, 999)],
+				(unsigned long)p_samples->p_scan[n - 1] );
+	}
+}
+
+/*
+ * Fragmentation index of the free blocks, as os_memory_get_pool_info
+ */
+static uint_t bench_fragmentation( const mpool_info_t *p_info )
+{
+	uint_t ret;
+
+	if( p_info->size == 0 )
+		ret = 0;
+	else if( p_info->size < 100 )
+		ret = (p_info->size - p_info->largest) * 100 / p_info->size;
+	else
+		ret = (p_info->size - p_info->largest) / (p_info->size / 100);
+
+	return ret;
+}
+
+static void bench_sample( unsigned long op, const mpool_t *p_mpool )
+{
+	mpool_info_t info;
+
+	mpool_gather_info( p_mpool, &info );
+	printf( "%9lu %8lu %8lu %8lu %6lu %4lu\n", op,
+			(unsigned long)(p_mpool->total_size - p_mpool->free_size),
+			(unsigned long)info.size,
+			(unsigned long)info.largest,
+			(unsigned long)info.count,
+			(unsigned long)bench_fragmentation(&info) );
+}
+
+/*
+ * Replay the trace against mpool_alloc/mpool_free
+ */
+static void bench_replay( uint_t pool_size, unsigned long interval )
+{
+	static mpool_t mpool;
+	static mlst_t mlst;
+	bench_samples_t allocs, frees;
+	unsigned long i, start, end;
+	const bench_op_t *p_op;
+	void *p;
+
+	allocs.p_ns = malloc( g_num_ops * sizeof(unsigned long) );
+	allocs.p_scan = malloc( g_num_ops * sizeof(uint_t) );
+	frees.p_ns = malloc( g_num_ops * sizeof(unsigned long) );
+	frees.p_scan = NULL;
+	allocs.count = 0;
+	frees.count = 0;
+
+	if( (allocs.p_ns == NULL) || (allocs.p_scan == NULL) || (frees.p_ns == NULL) )
+	{
+		fprintf( stderr, "out of memory\n" );
+		exit( EXIT_FAILURE );
+	}
+
+	memset( g_ptrs, 0, sizeof(g_ptrs) );
+	mpool_init( &mpool );
+	mpool_add( g_pool_mem, pool_size, &mpool );
+	mlst_init( &mlst );
+
+	printf( "%9s %8s %8s %8s %6s %4s\n", "op", "used", "free", "largest", "blocks", "frag" );
+
+	for( i = 0; i < g_num_ops; i++ )
+	{
+		p_op = &g_ops[i];
+
+		if( p_op->type == BENCH_FREE )
+		{
+			p = g_ptrs[p_op->id];
+
+			/* allocation failed, or freed twice by a recorded trace */
+			if( p != NULL )
+			{
+				start = bench_now();
+				mpool_free( p, &mpool );
+				end = bench_now();
+
+				frees.p_ns[frees.count++] = end - start;
+				g_ptrs[p_op->id] = NULL;
+			}
+		}
+		else if( g_ptrs[p_op->id] == NULL )
+		{
+			mpool.max_scan = 0;
+
+			start = bench_now();
+			p = mpool_alloc( p_op->size, &mpool, &mlst,
+					(p_op->type == BENCH_ALLOC_LONG)? MPOOL_LONG_LIVED : MPOOL_TRANSIENT );
+			end = bench_now();
+
+			allocs.p_ns[allocs.count] = end - start;
+			allocs.p_scan[allocs.count] = mpool.max_scan;
+			allocs.count++;
+
+			/* touch the block like a user would, outside the timing */
+			if( p != NULL )
+				memset( p, 0xA5, p_op->size );
+
+			g_ptrs[p_op->id] = p;
+		}
+
+		if( (interval != 0) && ((i + 1) % interval == 0) )
+			bench_sample( i + 1, &mpool );
+	}
+
+	if( (interval == 0) || (g_num_ops % interval != 0) )
+		bench_sample( g_num_ops, &mpool );
+
+	printf( "\n%s, pool %lu bytes, %lu operations, %lu allocation failures, "
+			"low-water mark %lu bytes\n", BENCH_POLICY_NAME,
+			(unsigned long)pool_size, g_num_ops,
+			(unsigned long)mpool.num_failures,
+			(unsigned long)mpool.min_free_size );
+
+	bench_report( "alloc", &allocs, true );
+	bench_report( "free", &frees, false );
+
+	free( allocs.p_ns );
+	free( allocs.p_scan );
+	free( frees.p_ns );
+}
+
+static void bench_usage( const char *p_prog )
+{
+	fprintf( stderr,
+			"usage: %s [-w uniform|bimodal|mixed] [-n ops] [-s seed]\n"
+			"          [-p pool_size] [-i interval] [trace_file]\n"
+			"Replays a synthetic workload, or a recorded trace when a file\n"
+			"is given, and reports latency percentiles, search lengths and\n"
+			"fragmentation every interval operations.\n", p_prog );
+}
+
+int main( int argc, char *argv[] )
+{
+	const char *p_workload = "uniform";
+	const char *p_trace = NULL;
+	unsigned long num_ops = 100000, interval = 10000;
+	unsigned long pool_size = 64 * 1024;
+	unsigned int seed = 1;
+	int i, ret;
+
+	for( i = 1; i < argc; i++ )
+	{
+		if( (argv[i][0] == '-') && (i + 1 < argc) )
+		{
+			if( strcmp(argv[i], "-w") == 0 )
+				p_workload = argv[++i];
+			else if( strcmp(argv[i], "-n") == 0 )
+				num_ops = strtoul( argv[++i], NULL, 0 );
+			else if( strcmp(argv[i], "-s") == 0 )
+				seed = (unsigned int)strtoul( argv[++i], NULL, 0 );
+			else if( strcmp(argv[i], "-p") == 0 )
+				pool_size = strtoul( argv[++i], NULL, 0 );
+			else if( strcmp(argv[i], "-i") == 0 )
+				interval = strtoul( argv[++i], NULL, 0 );
+			else
+			{
+				bench_usage( argv[0] );
+				return EXIT_FAILURE;
+			}
+		}
+		else if( argv[i][0] != '-' )
+			p_trace = argv[i];
+		else
+		{
+			bench_usage( argv[0] );
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( (pool_size > BENCH_MAX_POOL) || (pool_size < 1024) || (num_ops > BENCH_MAX_OPS) )
+	{
+		fprintf( stderr, "pool size must be 1024 to %lu, at most %lu operations\n",
+				(unsigned long)BENCH_MAX_POOL, (unsigned long)BENCH_MAX_OPS );
+		return EXIT_FAILURE;
+	}
+
+	srand( seed );
+
+	if( p_trace != NULL )
+		ret = bench_load( p_trace );
+	else
+		ret = bench_generate( p_workload, num_ops );
+
+	if( ret != 0 )
+	{
+		bench_usage( argv[0] );
+		return EXIT_FAILURE;
+	}
+
+	bench_replay( (uint_t)(pool_size & ~(unsigned long)(OSPORT_MEM_ALIGN - 1)), interval );
+	return EXIT_SUCCESS;
+}
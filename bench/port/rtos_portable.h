@@ -0,0 +1,71 @@
+/** ************************************************************************
+ * @file rtos_portable.h
+ * @brief Host port for the benchmarks, no scheduler and no interrupts
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef H6B1D3F0A_5C2E_4E8B_9A47_2D8F61C3B905
+#define H6B1D3F0A_5C2E_4E8B_9A47_2D8F61C3B905
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+ * Data types, a 32-bit target on a 64-bit host
+ */
+#define OSPORT_BYTE_T    uint8_t
+#define OSPORT_UINT_T    uint32_t
+#define OSPORT_UINTPTR_T uintptr_t
+#define OSPORT_BOOL_T    bool
+
+/*
+ * Configurations
+ */
+#define OSPORT_NUM_PRIOS       (8)
+#define OSPORT_MEM_ALIGN       (8)
+#define OSPORT_MEM_SMALLEST    (16)
+#define OSPORT_IDLE_STACK_SIZE (256)
+
+#if !defined(OSPORT_ENABLE_DEBUG)
+#	define OSPORT_ENABLE_DEBUG (0)
+#endif
+
+#define OSPORT_BREAKPOINT() abort()
+
+/*
+ * Functions, the benchmarks only call the unlocked kernel functions
+ * and never start the scheduler
+ */
+void bench_idle( void );
+
+#define OSPORT_IDLE_FUNC                    bench_idle
+#define OSPORT_INIT_STACK(P, SIZE, RET, ARG) \
+	((void)(SIZE), (void)(RET), (void)(ARG), (void*)(P))
+#define OSPORT_DISABLE_INT()                ((void)0)
+#define OSPORT_ENABLE_INT()                 ((void)0)
+#define OSPORT_CONTEXTSW_REQ()              ((void)0)
+#define OSPORT_START()                      abort()
+
+#endif /* H6B1D3F0A_5C2E_4E8B_9A47_2D8F61C3B905 */
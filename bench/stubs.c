@@ -0,0 +1,91 @@
+/** ************************************************************************
+ * @file stubs.c
+ * @brief Kernel symbols referenced by the benchmarked modules
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#include <stdlib.h>
+#include "../rtos_module.h"
+
+/*
+ * The benchmarks drive the unlocked kernel functions directly, without
+ * a scheduler. The symbols below are only reached through the locked
+ * wrappers and the pressure thread, which are never called.
+ */
+mpool_t g_mpool;
+sch_cblk_t g_sch;
+
+void sch_lock_int( sch_cblk_t *p_sch )
+{
+	(void)p_sch;
+}
+
+void sch_unlock_int( sch_cblk_t *p_sch )
+{
+	(void)p_sch;
+}
+
+void sch_lock_preempt( sch_cblk_t *p_sch )
+{
+	(void)p_sch;
+}
+
+void sch_unlock_preempt( sch_cblk_t *p_sch )
+{
+	(void)p_sch;
+}
+
+void thd_reclaim( sch_cblk_t *p_sch, mpool_t *p_mpool )
+{
+	(void)p_sch;
+	(void)p_mpool;
+}
+
+void sem_init( sem_cblk_t *p_sem, uint_t initial )
+{
+	(void)p_sem;
+	(void)initial;
+}
+
+void sem_reset( sem_cblk_t *p_sem, uint_t counter, sch_cblk_t *p_sch )
+{
+	(void)p_sem;
+	(void)counter;
+	(void)p_sch;
+}
+
+os_bool_t os_semaphore_wait( os_handle_t h_sem, os_uint_t timeout )
+{
+	(void)h_sem;
+	(void)timeout;
+	abort();
+}
+
+os_handle_t os_thread_create( os_uint_t prio, os_uint_t stack_size, void (*p_job)(void) )
+{
+	(void)prio;
+	(void)stack_size;
+	(void)p_job;
+	abort();
+}
@@ -51,6 +51,24 @@ void      os_exit_critical        ( void );
 }
 #endif
 
+/* Memory allocation hint */
+typedef enum
+{
+	OS_MEMORY_TRANSIENT = 0, /* short-lived, placed from the low end of the pool */
+	OS_MEMORY_LONG_LIVED     /* kept for long, placed from the high end          */
+} os_memory_hint_t;
+
+/* Memory pressure level */
+typedef enum
+{
+	OS_MEMORY_PRESSURE_NONE = 0, /* free size above low watermark         */
+	OS_MEMORY_PRESSURE_LOW,      /* free size below low watermark         */
+	OS_MEMORY_PRESSURE_CRITICAL  /* below critical watermark, or failures */
+} os_memory_pressure_t;
+
+/* Memory pressure callback */
+typedef void (*os_memory_pressure_cb_t)( os_memory_pressure_t level );
+
 /* Information about a memory block */
 typedef struct {
 	os_uint_t block_size; /* size of memory block */
@@ -58,10 +76,28 @@ typedef struct {
 
 /* Information about the system memory pool */
 typedef struct {
-	os_uint_t pool_size;  /* size of memory pool             */
-	os_uint_t num_blocks; /* number of blocks in memory pool */
+	os_uint_t pool_size;       /* free size of memory pool                  */
+	os_uint_t num_blocks;      /* number of free blocks in memory pool      */
+	os_uint_t total_size;      /* size managed by memory pool               */
+	os_uint_t min_free_size;   /* lowest free size ever reached             */
+	os_uint_t peak_used_size;  /* highest allocated size ever reached       */
+	os_uint_t max_alloc_size;  /* largest size that can be allocated now    */
+	os_uint_t num_allocs;      /* number of successful allocations          */
+	os_uint_t num_frees;       /* number of frees                           */
+	os_uint_t num_failures;    /* number of failed allocations              */
+	os_uint_t fragmentation;   /* fragmentation index, 0 to 100             */
+	os_uint_t max_scan_length; /* most blocks searched by one allocation    */
+	os_uint_t free_histogram[OSPORT_MEM_NUM_SIZE_CLASSES]; /* free blocks per size class */
 } os_memory_pool_info_t;
 
+/* Memory held by a call site */
+typedef struct {
+	const void *p_tag;    /* call site tag or return address           */
+	os_uint_t live_size;  /* size of memory held by call site          */
+	os_uint_t num_blocks; /* number of memory blocks held by call site */
+	os_uint_t max_age;    /* age of the oldest block in ticks          */
+} os_memory_trace_t;
+
 /* Information about thread memory allocation */
 typedef struct {
 	os_uint_t thread_size; /* size of memory allocated to thread          */
@@ -73,10 +109,33 @@ extern "C" {
 #endif
 
 void*  os_memory_allocate       ( os_uint_t size );
+void*  os_memory_allocate_tagged( os_uint_t size, const void *p_tag );
+void*  os_memory_allocate_ex    ( os_uint_t size, os_memory_hint_t hint );
 void   os_memory_free           ( void *p );
+void   os_memory_free_deferred  ( void *p );
+void   os_memory_collect        ( void );
 void   os_memory_get_block_info ( void *p, os_memory_block_info_t *p_info );
 void   os_memory_get_thread_info( os_handle_t h_thread, os_memory_thread_info_t *p_info );
 void   os_memory_get_pool_info  ( os_memory_pool_info_t *p_info );
+os_uint_t os_memory_get_trace   ( os_memory_trace_t *p_entries, os_uint_t max );
+const void* os_memory_check_step( void );
+void   os_memory_set_watermarks ( os_uint_t low_size, os_uint_t critical_size );
+os_memory_pressure_t os_memory_get_pressure( void );
+os_bool_t os_memory_register_pressure_cb( os_memory_pressure_cb_t p_cb );
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+os_handle_t os_arena_create          ( os_uint_t size );
+void        os_arena_delete          ( os_handle_t h_arena );
+void*       os_arena_allocate        ( os_handle_t h_arena, os_uint_t size );
+void        os_arena_reset           ( os_handle_t h_arena );
+os_uint_t   os_arena_get_free_size   ( os_handle_t h_arena );
 
 #ifdef __cplusplus
 }
@@ -145,6 +204,36 @@ os_bool_t         os_mutex_is_locked            ( os_handle_t h_mutex );
 }
 #endif
 
+/* Part of a queue buffer, written or read in place */
+typedef struct {
+	void *p_data[2];   /* start of each part, the second part wraps around */
+	os_uint_t size[2]; /* size of each part, 0 if unused                    */
+} os_queue_span_t;
+
+/* Order in which blocked queue senders and receivers are served */
+typedef enum
+{
+	OS_QUEUE_POLICY_HEAD_OF_LINE, /* only the first waiter, strictly in order */
+	OS_QUEUE_POLICY_FIRST_FIT     /* first waiter that fits, bounded scan     */
+} os_queue_policy_t;
+
+/* Queue statistics, all zero unless OSPORT_QUEUE_STATS is enabled */
+typedef struct {
+	os_uint_t max_used_size;        /* most bytes held at once, including reserved */
+	os_uint_t bytes_in;             /* total bytes sent                            */
+	os_uint_t bytes_out;            /* total bytes received                        */
+	os_uint_t num_blocked_sends;    /* sends that had to wait                      */
+	os_uint_t num_blocked_receives; /* receives and peeks that had to wait         */
+	os_uint_t blocked_time;         /* ticks spent waiting by all threads          */
+	os_uint_t num_timeouts;         /* waits that ended without success            */
+} os_queue_stats_t;
+
+/* Segment of a message held in a separate buffer */
+typedef struct {
+	void *p_data;   /* segment data */
+	os_uint_t size; /* segment size */
+} os_queue_seg_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -152,9 +241,11 @@ extern "C" {
 os_handle_t       os_queue_create               ( os_uint_t size );
 void              os_queue_delete               ( os_handle_t h_q );
 void              os_queue_reset                ( os_handle_t h_q );
+void              os_queue_set_policy           ( os_handle_t h_q, os_queue_policy_t policy );
 os_uint_t         os_queue_get_size             ( os_handle_t h_q );
 os_uint_t         os_queue_get_used_size        ( os_handle_t h_q );
 os_uint_t         os_queue_get_free_size        ( os_handle_t h_q );
+void              os_queue_get_stats            ( os_handle_t h_q, os_queue_stats_t *p_stats );
 os_bool_t         os_queue_peek                 ( os_handle_t h_q, void *p_data, os_uint_t size, os_uint_t timeout );
 os_bool_t         os_queue_peek_nb              ( os_handle_t h_q, void *p_data, os_uint_t size );
 os_bool_t         os_queue_send                 ( os_handle_t h_q, const void *p_data, os_uint_t size, os_uint_t timeout );
@@ -163,6 +254,134 @@ os_bool_t         os_queue_send_nb              ( os_handle_t h_q, const void *p
 os_bool_t         os_queue_send_ahead_nb        ( os_handle_t h_q, const void *p_data, os_uint_t size );
 os_bool_t         os_queue_receive              ( os_handle_t h_q, void *p_data, os_uint_t size, os_uint_t timeout );
 os_bool_t         os_queue_receive_nb           ( os_handle_t h_q, void *p_data, os_uint_t size );
+os_uint_t         os_queue_receive_stream       ( os_handle_t h_q, void *p_data, os_uint_t trigger, os_uint_t max, os_uint_t timeout );
+os_bool_t         os_queue_sendv                ( os_handle_t h_q, const os_queue_seg_t *p_segs, os_uint_t num, os_uint_t timeout );
+os_bool_t         os_queue_sendv_nb             ( os_handle_t h_q, const os_queue_seg_t *p_segs, os_uint_t num );
+os_bool_t         os_queue_receivev             ( os_handle_t h_q, const os_queue_seg_t *p_segs, os_uint_t num, os_uint_t timeout );
+os_bool_t         os_queue_receivev_nb          ( os_handle_t h_q, const os_queue_seg_t *p_segs, os_uint_t num );
+os_bool_t         os_queue_send_reserve         ( os_handle_t h_q, os_uint_t size, os_queue_span_t *p_span, os_uint_t timeout );
+os_bool_t         os_queue_send_commit          ( os_handle_t h_q, const os_queue_span_t *p_span );
+os_bool_t         os_queue_receive_acquire      ( os_handle_t h_q, os_uint_t size, os_queue_span_t *p_span, os_uint_t timeout );
+os_bool_t         os_queue_receive_release      ( os_handle_t h_q, const os_queue_span_t *p_span );
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+os_handle_t       os_msgq_create                ( os_uint_t item_size, os_uint_t item_count );
+void              os_msgq_delete                ( os_handle_t h_msgq );
+void              os_msgq_reset                 ( os_handle_t h_msgq );
+os_uint_t         os_msgq_get_count             ( os_handle_t h_msgq );
+os_bool_t         os_msgq_send                  ( os_handle_t h_msgq, const void *p_data, os_uint_t timeout );
+os_bool_t         os_msgq_send_nb               ( os_handle_t h_msgq, const void *p_data );
+os_bool_t         os_msgq_send_ahead            ( os_handle_t h_msgq, const void *p_data, os_uint_t timeout );
+os_bool_t         os_msgq_send_ahead_nb         ( os_handle_t h_msgq, const void *p_data );
+os_bool_t         os_msgq_receive               ( os_handle_t h_msgq, void *p_data, os_uint_t timeout );
+os_bool_t         os_msgq_receive_nb            ( os_handle_t h_msgq, void *p_data );
+os_bool_t         os_msgq_peek                  ( os_handle_t h_msgq, void *p_data, os_uint_t timeout );
+os_bool_t         os_msgq_peek_nb               ( os_handle_t h_msgq, void *p_data );
+os_handle_t       os_mailbox_create             ( os_uint_t count );
+void              os_mailbox_delete             ( os_handle_t h_mailbox );
+os_bool_t         os_mailbox_send               ( os_handle_t h_mailbox, void *p_block, os_uint_t timeout );
+os_bool_t         os_mailbox_send_nb            ( os_handle_t h_mailbox, void *p_block );
+void*             os_mailbox_receive            ( os_handle_t h_mailbox, os_uint_t timeout );
+void*             os_mailbox_receive_nb         ( os_handle_t h_mailbox );
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+os_handle_t       os_pmsgq_create               ( os_uint_t item_size, os_uint_t item_count );
+void              os_pmsgq_delete               ( os_handle_t h_pmsgq );
+os_uint_t         os_pmsgq_get_count            ( os_handle_t h_pmsgq );
+os_bool_t         os_pmsgq_send                 ( os_handle_t h_pmsgq, const void *p_data, os_uint_t prio, os_uint_t timeout );
+os_bool_t         os_pmsgq_send_nb              ( os_handle_t h_pmsgq, const void *p_data, os_uint_t prio );
+os_bool_t         os_pmsgq_receive              ( os_handle_t h_pmsgq, void *p_data, os_uint_t timeout );
+os_bool_t         os_pmsgq_receive_nb           ( os_handle_t h_pmsgq, void *p_data );
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+os_handle_t       os_objq_create                ( os_uint_t block_size, os_uint_t block_count );
+void              os_objq_delete                ( os_handle_t h_objq );
+void*             os_objq_alloc                 ( os_handle_t h_objq, os_uint_t timeout );
+void*             os_objq_alloc_nb              ( os_handle_t h_objq );
+void              os_objq_free                  ( os_handle_t h_objq, void *p_block );
+void              os_objq_send                  ( os_handle_t h_objq, void *p_block );
+void*             os_objq_receive               ( os_handle_t h_objq, os_uint_t timeout );
+void*             os_objq_receive_nb            ( os_handle_t h_objq );
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+os_handle_t       os_ring_create                ( os_uint_t size );
+void              os_ring_delete                ( os_handle_t h_ring );
+os_uint_t         os_ring_get_used_size         ( os_handle_t h_ring );
+os_uint_t         os_ring_write                 ( os_handle_t h_ring, const void *p_data, os_uint_t size );
+os_uint_t         os_ring_read                  ( os_handle_t h_ring, void *p_data, os_uint_t size );
+os_bool_t         os_ring_wait                  ( os_handle_t h_ring, os_uint_t level, os_uint_t timeout );
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+os_handle_t       os_topic_create               ( void );
+void              os_topic_delete               ( os_handle_t h_topic );
+os_handle_t       os_topic_subscribe            ( os_handle_t h_topic, os_uint_t count );
+void              os_topic_unsubscribe          ( os_handle_t h_sub );
+void*             os_topic_alloc                ( os_uint_t size );
+os_uint_t         os_topic_publish              ( os_handle_t h_topic, void *p_msg );
+void*             os_topic_receive              ( os_handle_t h_sub, os_uint_t timeout );
+void*             os_topic_receive_nb           ( os_handle_t h_sub );
+void              os_topic_release              ( void *p_msg );
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Kind of object waited on by os_wait_any */
+typedef enum
+{
+	OS_WAIT_SEMAPHORE = 0, /* counter above zero                  */
+	OS_WAIT_MUTEX,         /* unlocked, or locked by the caller   */
+	OS_WAIT_QUEUE,         /* at least size bytes to receive      */
+	OS_WAIT_MSGQ           /* at least one item to receive        */
+} os_wait_type_t;
+
+/* Object waited on by os_wait_any */
+typedef struct {
+	os_handle_t h_object; /* handle to the object             */
+	os_wait_type_t type;  /* kind of object                   */
+	os_uint_t size;       /* bytes awaited, OS_WAIT_QUEUE only */
+} os_wait_object_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+os_uint_t         os_wait_any                   ( const os_wait_object_t *p_objects, os_uint_t num, os_uint_t timeout );
 
 #ifdef __cplusplus
 }
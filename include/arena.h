@@ -0,0 +1,65 @@
+/** ************************************************************************
+ * @file arena.h
+ * @brief Arena allocator
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef HD6CE4AD3_7F15_44A3_AEA9_222D58BB4612
+#define HD6CE4AD3_7F15_44A3_AEA9_222D58BB4612
+
+#include "util.h"
+
+/*
+ * Type declarations
+ */
+struct arena_cblk_s;
+
+typedef struct arena_cblk_s arena_cblk_t;
+
+/*
+ * Arena control block
+ */
+struct arena_cblk_s
+{
+	byte_t *volatile p_buffer; /* arena memory buffer */
+	volatile uint_t size;      /* size of buffer      */
+	volatile uint_t used;      /* allocated size      */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Arena functions
+ */
+UTIL_UNSAFE void arena_init( arena_cblk_t *p_arena, void *p_buffer, uint_t size );
+UTIL_UNSAFE void *arena_alloc( arena_cblk_t *p_arena, uint_t size );
+UTIL_UNSAFE void arena_reset( arena_cblk_t *p_arena );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HD6CE4AD3_7F15_44A3_AEA9_222D58BB4612 */
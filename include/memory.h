@@ -5,7 +5,8 @@
  *
  * This file is part of mRTOS.
  *
- * This implementation uses the next fit algorithm.
+ * This implementation uses the next fit algorithm by default, first fit
+ * or best fit can be selected with OSPORT_MEM_POLICY.
  *
  * Copyright (C) 2018 John Buyi Yu
  *
@@ -43,6 +44,78 @@ typedef struct mblk_s mblk_t;
 typedef struct mlst_s mlst_t;
 typedef struct mpool_s mpool_t;
 
+struct sch_cblk_s;
+struct sem_cblk_s;
+
+/*
+ * Check the alignment of a size or address
+ */
+#define MPOOL_IS_ALIGNED(VAL)  \
+	(((handle_t)(VAL) % OSPORT_MEM_ALIGN) == 0)
+
+/*
+ * Align a memory block size, sizes above MPOOL_SIZE_MAX wrap
+ */
+#define MPOOL_ALIGN(VAL) \
+	(((VAL)%OSPORT_MEM_ALIGN)? \
+		((VAL)+OSPORT_MEM_ALIGN-(VAL)%OSPORT_MEM_ALIGN):(VAL))
+
+/*
+ * Largest size that can be aligned
+ */
+#define MPOOL_SIZE_MAX \
+	((uint_t)-1 - OSPORT_MEM_ALIGN)
+
+/*
+ * Allocation placement hint
+ */
+typedef enum
+{
+	MPOOL_TRANSIENT = 0, /* placed by the pool policy, from the low end */
+	MPOOL_LONG_LIVED     /* placed from the high end of the pool       */
+} mpool_hint_t;
+
+/*
+ * Memory pressure level, ordered by severity
+ */
+typedef enum
+{
+	MPOOL_PRESSURE_NONE = 0, /* free size above low watermark      */
+	MPOOL_PRESSURE_LOW,      /* free size below low watermark      */
+	MPOOL_PRESSURE_CRITICAL  /* below critical watermark or failed */
+} mpool_pressure_t;
+
+#if OSPORT_MEM_COMPACT
+/*
+ * Compact memory block header, the links are only kept
+ * in free blocks and overlay the payload.
+ * Order of members makes a difference.
+ */
+struct mblk_s
+{
+	volatile uint_t size;           /* block size              */
+	volatile uint_t owner;          /* parent list index       */
+#if OSPORT_MEM_TRACE
+	const void *volatile p_tag;     /* call site tag           */
+	volatile uint_t timestamp;      /* allocated time          */
+#endif
+#if OSPORT_MEM_GUARD
+	volatile uint_t guard;          /* guard word              */
+#endif
+	struct mblk_s *volatile p_prev; /* previous block, if free */
+	struct mblk_s *volatile p_next; /* next block, if free     */
+};
+
+/*
+ * Compact memory list header, blocks are only counted
+ */
+struct mlst_s
+{
+	volatile uint_t size;  /* size in list             */
+	volatile uint_t count; /* number of blocks in list */
+	volatile uint_t owner; /* index, 0 when empty      */
+};
+#else
 /*
  * Memory block header
  * Order of members makes a difference.
@@ -53,6 +126,13 @@ struct mblk_s
 	struct mblk_s *volatile p_next; /* next block     */
 	volatile uint_t size;           /* block size     */
 	struct mlst_s *volatile p_mlst; /* parent list    */
+#if OSPORT_MEM_TRACE
+	const void *volatile p_tag;     /* call site tag  */
+	volatile uint_t timestamp;      /* allocated time */
+#endif
+#if OSPORT_MEM_GUARD
+	volatile uint_t guard;          /* guard word     */
+#endif
 };
 
 /*
@@ -62,14 +142,33 @@ struct mlst_s
 {
 	struct mblk_s *volatile p_head; /* list head */
 };
+#endif
 
 /*
  * Memory pool header
  */
 struct mpool_s
 {
-	struct mblk_s *volatile p_head;       /* pool head       */
-	struct mblk_s *volatile p_alloc_head; /* allocation head */
+	struct mblk_s *volatile p_head;       /* pool head                 */
+	struct mblk_s *volatile p_alloc_head; /* allocation head           */
+	volatile uint_t total_size;           /* size managed by pool      */
+	volatile uint_t free_size;            /* size of free blocks       */
+	volatile uint_t min_free_size;        /* free size low-water mark  */
+	volatile uint_t num_allocs;           /* successful allocations    */
+	volatile uint_t num_frees;            /* frees                     */
+	volatile uint_t num_failures;         /* failed allocations        */
+	void *volatile p_start;               /* start of pool memory      */
+	void *volatile p_end;                 /* end of pool memory        */
+	struct mblk_s *volatile p_check;      /* integrity check position  */
+	struct mblk_s *volatile p_corrupt;    /* first corrupted block     */
+	volatile uint_t max_scan;             /* longest allocation search */
+	volatile bool_t locked;               /* pool in use               */
+	void *volatile p_deferred;            /* frees deferred by ISRs    */
+	volatile uint_t low_size;             /* low watermark             */
+	volatile uint_t critical_size;        /* critical watermark        */
+	volatile uint_t pressure;             /* memory pressure level     */
+	volatile bool_t pressure_raised;      /* level raised, not posted  */
+	struct sem_cblk_s *volatile p_pressure_sem; /* posted when raised  */
 };
 
 #ifdef __cplusplus
@@ -81,6 +180,7 @@ extern "C" {
 UTIL_UNSAFE void mblk_init(mblk_t *p_mblk, uint_t size);
 UTIL_UNSAFE void mlst_init(mlst_t *p_mlst );
 UTIL_UNSAFE void mpool_init(mpool_t *p_mpool);
+UTIL_UNSAFE void mpool_add(void *p_mem, uint_t size, mpool_t *p_mpool);
 
 /*
  * Memory list functions
@@ -99,8 +199,39 @@ UTIL_UNSAFE void mpool_merge(mblk_t *p_mblk, mpool_t *p_mpool);
 /*
  * Memory allocation functions
  */
-UTIL_UNSAFE void *mpool_alloc(uint_t size, mpool_t *p_mpool, mlst_t *p_mlst );
+UTIL_UNSAFE void *mpool_alloc(uint_t size, mpool_t *p_mpool, mlst_t *p_mlst, mpool_hint_t hint);
 UTIL_UNSAFE void mpool_free(void *p, mpool_t *p_mpool);
+UTIL_UNSAFE void mpool_reclaim(mlst_t *p_mlst, mpool_t *p_mpool);
+UTIL_UNSAFE bool_t mpool_transfer(void *p, mlst_t *p_mlst);
+
+/*
+ * Pool lock, the pool is walked and modified with interrupts enabled
+ * while the lock is held
+ */
+UTIL_SAFE bool_t mpool_lock(mpool_t *p_mpool, struct sch_cblk_s *p_sch);
+UTIL_SAFE void mpool_unlock(mpool_t *p_mpool, struct sch_cblk_s *p_sch);
+UTIL_SAFE void mpool_defer(void *p, mpool_t *p_mpool);
+UTIL_UNSAFE void mpool_drain(mpool_t *p_mpool);
+UTIL_SAFE void *mpool_lock_alloc(uint_t size, mpool_t *p_mpool, mlst_t *p_mlst,
+		mpool_hint_t hint, struct sch_cblk_s *p_sch);
+UTIL_SAFE void mpool_lock_free(void *p, mpool_t *p_mpool, struct sch_cblk_s *p_sch);
+
+/*
+ * Integrity check
+ */
+UTIL_UNSAFE mblk_t *mpool_check(mpool_t *p_mpool, uint_t count);
+
+/*
+ * Call site tagging, only available with OSPORT_MEM_TRACE
+ */
+#if OSPORT_MEM_TRACE
+UTIL_UNSAFE void mpool_tag(void *p, const void *p_tag);
+#	define MPOOL_TAG(P, P_TAG) \
+		mpool_tag((P), (P_TAG))
+#else
+#	define MPOOL_TAG(P, P_TAG) \
+		((void)0)
+#endif
 
 #ifdef __cplusplus
 }
@@ -122,7 +253,9 @@ typedef struct mpool_info_s mpool_info_t;
  */
 struct mblk_info_s
 {
-	uint_t size; /* size */
+	uint_t size;       /* size           */
+	const void *p_tag; /* call site tag  */
+	uint_t timestamp;  /* allocated time */
 };
 
 /*
@@ -139,8 +272,10 @@ struct mlst_info_s
  */
 struct mpool_info_s
 {
-	uint_t size;  /* size in pool             */
-	uint_t count; /* number of blocks in pool */
+	uint_t size;                                   /* size in pool               */
+	uint_t count;                                  /* number of blocks in pool   */
+	uint_t largest;                                /* largest block in pool      */
+	uint_t histogram[OSPORT_MEM_NUM_SIZE_CLASSES]; /* blocks in each size class  */
 };
 
 #ifdef __cplusplus
@@ -150,6 +285,7 @@ extern "C" {
 UTIL_UNSAFE void mblk_gather_info( const mblk_t *p_mblk, mblk_info_t *p_info);
 UTIL_UNSAFE void mlst_gather_info( const mlst_t *p_mlst, mlst_info_t *p_info);
 UTIL_UNSAFE void mpool_gather_info( const mpool_t *p_mpool, mpool_info_t *p_info);
+UTIL_UNSAFE mblk_t *mpool_next_used( const mpool_t *p_mpool, const mblk_t *p_mblk );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,96 @@
+/** ************************************************************************
+ * @file msgq.h
+ * @brief Fixed-size message queue
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef H5B0E7A61_2C4D_4F0B_9E3A_7D18C6F2A9B4
+#define H5B0E7A61_2C4D_4F0B_9E3A_7D18C6F2A9B4
+
+#include "util.h"
+#include "thread.h"
+#include "queue.h"
+
+/*
+ * Type declarations
+ */
+struct msgq_cblk_s;
+struct msgq_ops_s;
+
+typedef struct msgq_cblk_s msgq_cblk_t;
+typedef struct msgq_ops_s msgq_ops_t;
+
+/*
+ * Message queue control block, waiting threads use
+ * the queue scheduling info with a size of one item
+ */
+struct msgq_cblk_s
+{
+	byte_t *volatile p_buffer;       /* item slots                     */
+	struct sch_qprio_s q_wait_read;  /* reading wait queue             */
+	struct sch_qprio_s q_wait_write; /* writing wait queue             */
+	volatile uint_t item_size;       /* size of an item                */
+	volatile uint_t item_count;      /* number of slots                */
+	volatile uint_t mask;            /* count-1 if a power of 2, or 0  */
+	volatile uint_t read;            /* slot of the first item         */
+	volatile uint_t count;           /* number of items in queue       */
+};
+
+/*
+ * Item operations of a message queue kind, used to serve waiting
+ * threads, p_read returns true if it freed a slot
+ */
+struct msgq_ops_s
+{
+	void (*p_write)( void *p_obj, const queue_schinfo_write_t *p_writeinfo ); /* store writer's item */
+	bool_t (*p_read)( void *p_obj, const queue_schinfo_read_t *p_readinfo );  /* serve reader        */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Message queue functions
+ */
+UTIL_UNSAFE void msgq_init( msgq_cblk_t *p_msgq, void *p_buffer, uint_t item_size, uint_t item_count );
+UTIL_UNSAFE void msgq_delete_static( msgq_cblk_t *p_msgq, sch_cblk_t *p_sch );
+UTIL_UNSAFE void msgq_write( msgq_cblk_t *p_msgq, const byte_t *p_data );
+UTIL_UNSAFE void msgq_write_ahead( msgq_cblk_t *p_msgq, const byte_t *p_data );
+UTIL_UNSAFE void msgq_read( msgq_cblk_t *p_msgq, byte_t *p_data );
+UTIL_UNSAFE void msgq_peek( const msgq_cblk_t *p_msgq, byte_t *p_data );
+UTIL_UNSAFE void msgq_unlock_threads( msgq_cblk_t *p_msgq, sch_cblk_t *p_sch );
+
+/*
+ * Shared by the message queue kinds
+ */
+UTIL_UNSAFE void msgq_ready_all( sch_qprio_t *p_wait_read, sch_qprio_t *p_wait_write, sch_cblk_t *p_sch );
+UTIL_UNSAFE void msgq_serve_threads( sch_qprio_t *p_wait_read, sch_qprio_t *p_wait_write, void *p_obj,
+		const volatile uint_t *p_count, uint_t item_count, const msgq_ops_t *p_ops, sch_cblk_t *p_sch );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H5B0E7A61_2C4D_4F0B_9E3A_7D18C6F2A9B4 */
@@ -0,0 +1,76 @@
+/** ************************************************************************
+ * @file objq.h
+ * @brief Object queue, fixed-size blocks passed by handle
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef H6F2D8B40_C35A_4E71_9A06_B81E4C7D2F53
+#define H6F2D8B40_C35A_4E71_9A06_B81E4C7D2F53
+
+#include "util.h"
+#include "thread.h"
+#include "queue.h"
+#include "msgq.h"
+
+/*
+ * Type declarations
+ */
+struct objq_cblk_s;
+
+typedef struct objq_cblk_s objq_cblk_t;
+
+/*
+ * Object queue control block, free blocks are linked through their
+ * first word, and filled blocks are queued by pointer. Threads waiting
+ * to allocate use the queue read scheduling info, receiving the block
+ * pointer into p_data
+ */
+struct objq_cblk_s
+{
+	byte_t *volatile p_blocks;        /* first block                 */
+	void *volatile p_free;            /* free block list             */
+	struct sch_qprio_s q_wait_alloc;  /* allocating wait queue       */
+	volatile uint_t block_size;       /* size of a block             */
+	volatile uint_t block_count;      /* number of blocks            */
+	volatile uint_t num_free;         /* blocks on the free list     */
+	struct msgq_cblk_s msgq;          /* queued block pointers       */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Object queue functions
+ */
+UTIL_UNSAFE void objq_init( objq_cblk_t *p_objq, void *p_blocks, void *p_slots, uint_t block_size, uint_t block_count );
+UTIL_UNSAFE void objq_delete_static( objq_cblk_t *p_objq, sch_cblk_t *p_sch );
+UTIL_UNSAFE void *objq_alloc( objq_cblk_t *p_objq );
+UTIL_UNSAFE void objq_free( objq_cblk_t *p_objq, void *p_block, sch_cblk_t *p_sch );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H6F2D8B40_C35A_4E71_9A06_B81E4C7D2F53 */
@@ -0,0 +1,84 @@
+/** ************************************************************************
+ * @file pmsgq.h
+ * @brief Priority message queue
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef HA4E07B35_91C2_4F6D_8B1E_3D5C72F0A968
+#define HA4E07B35_91C2_4F6D_8B1E_3D5C72F0A968
+
+#include "util.h"
+#include "thread.h"
+#include "queue.h"
+
+/*
+ * Type declarations
+ */
+struct pmsgq_cblk_s;
+
+typedef struct pmsgq_cblk_s pmsgq_cblk_t;
+
+/*
+ * End of a slot list
+ */
+#define PMSGQ_NONE ((uint_t)-1)
+
+/*
+ * Priority message queue control block, each priority keeps a list
+ * of slots linked through p_link, waiting threads use the queue
+ * scheduling info with a size of one item
+ */
+struct pmsgq_cblk_s
+{
+	byte_t *volatile p_buffer;                   /* item slots                  */
+	uint_t *volatile p_link;                     /* next slot of each slot      */
+	struct sch_qprio_s q_wait_read;              /* reading wait queue          */
+	struct sch_qprio_s q_wait_write;             /* writing wait queue          */
+	volatile uint_t item_size;                   /* size of an item             */
+	volatile uint_t item_count;                  /* number of slots             */
+	volatile uint_t count;                       /* number of items in queue    */
+	volatile uint_t free;                        /* first free slot             */
+	volatile uint_t bitmap;                      /* priorities holding items    */
+	volatile uint_t head[OSPORT_PMSGQ_NUM_PRIOS]; /* first slot of each priority */
+	volatile uint_t tail[OSPORT_PMSGQ_NUM_PRIOS]; /* last slot of each priority  */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Priority message queue functions
+ */
+UTIL_UNSAFE void pmsgq_init( pmsgq_cblk_t *p_pmsgq, void *p_buffer, uint_t *p_link, uint_t item_size, uint_t item_count );
+UTIL_UNSAFE void pmsgq_delete_static( pmsgq_cblk_t *p_pmsgq, sch_cblk_t *p_sch );
+UTIL_UNSAFE void pmsgq_write( pmsgq_cblk_t *p_pmsgq, const byte_t *p_data, uint_t prio );
+UTIL_UNSAFE void pmsgq_read( pmsgq_cblk_t *p_pmsgq, byte_t *p_data );
+UTIL_UNSAFE void pmsgq_unlock_threads( pmsgq_cblk_t *p_pmsgq, sch_cblk_t *p_sch );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HA4E07B35_91C2_4F6D_8B1E_3D5C72F0A968 */
@@ -62,6 +62,90 @@
 #	endif
 #endif
 
+/* memory placement policies */
+#define OSPORT_MEM_NEXT_FIT  (0)
+#define OSPORT_MEM_FIRST_FIT (1)
+#define OSPORT_MEM_BEST_FIT  (2)
+
+#if !defined(OSPORT_MEM_POLICY)
+#	define OSPORT_MEM_POLICY OSPORT_MEM_NEXT_FIT
+#endif
+
+#if (OSPORT_MEM_POLICY != OSPORT_MEM_NEXT_FIT) && \
+	(OSPORT_MEM_POLICY != OSPORT_MEM_FIRST_FIT) && \
+	(OSPORT_MEM_POLICY != OSPORT_MEM_BEST_FIT)
+#	error "Invalid memory placement policy."
+#endif
+
+#if !defined(OSPORT_MEM_NUM_SIZE_CLASSES)
+#	define OSPORT_MEM_NUM_SIZE_CLASSES (8)
+#endif
+
+#if !defined(OSPORT_MEM_TRACE)
+#	define OSPORT_MEM_TRACE (0)
+#endif
+
+#if !defined(OSPORT_MEM_GUARD)
+#	define OSPORT_MEM_GUARD (0)
+#endif
+
+#if !defined(OSPORT_MEM_COMPACT)
+#	define OSPORT_MEM_COMPACT (0)
+#endif
+
+#if !defined(OSPORT_MEM_NUM_OWNERS)
+#	define OSPORT_MEM_NUM_OWNERS (16)
+#endif
+
+#if !defined(OSPORT_MEM_PRESSURE_PRIO)
+#	define OSPORT_MEM_PRESSURE_PRIO (0)
+#endif
+
+#if !defined(OSPORT_MEM_PRESSURE_STACK_SIZE)
+#	define OSPORT_MEM_PRESSURE_STACK_SIZE OSPORT_IDLE_STACK_SIZE
+#endif
+
+#if !defined(OSPORT_MEM_PRESSURE_NUM_CBS)
+#	define OSPORT_MEM_PRESSURE_NUM_CBS (4)
+#endif
+
+#if !defined(OSPORT_MEM_CHECK_STEP)
+#	define OSPORT_MEM_CHECK_STEP (4)
+#endif
+
+#if !defined(OSPORT_WAIT_MAX_OBJECTS)
+#	define OSPORT_WAIT_MAX_OBJECTS (8)
+#endif
+
+#if !defined(OSPORT_QUEUE_LOCKED_COPY_MAX)
+#	define OSPORT_QUEUE_LOCKED_COPY_MAX (64)
+#endif
+
+#if !defined(OSPORT_QUEUE_SCAN_MAX)
+#	define OSPORT_QUEUE_SCAN_MAX (4)
+#endif
+
+#if !defined(OSPORT_QUEUE_STATS)
+#	define OSPORT_QUEUE_STATS (0)
+#endif
+
+#if !defined(OSPORT_PMSGQ_NUM_PRIOS)
+#	define OSPORT_PMSGQ_NUM_PRIOS (8)
+#endif
+
+/* one bit per priority, a uint_t has at least 16 */
+#if (OSPORT_PMSGQ_NUM_PRIOS < 1) || (OSPORT_PMSGQ_NUM_PRIOS > 16)
+#	error "Invalid number of priority message queue priorities."
+#endif
+
+#if !defined(OSPORT_MEMORY_BARRIER)
+#	define OSPORT_MEMORY_BARRIER() ((void)0)
+#endif
+
+#if !defined(OSPORT_CALLER_ADDRESS)
+#	define OSPORT_CALLER_ADDRESS() ((void*)0)
+#endif
+
 typedef OSPORT_BYTE_T os_byte_t;
 typedef OSPORT_UINT_T os_uint_t;
 typedef OSPORT_UINTPTR_T os_handle_t;
@@ -37,10 +37,30 @@
 struct queue_cblk_s;
 struct queue_schinfo_read_s;
 struct queue_schinfo_write_s;
+struct queue_span_s;
+struct queue_seg_s;
+struct queue_stats_s;
 
 typedef struct queue_cblk_s queue_cblk_t;
 typedef struct queue_schinfo_read_s queue_schinfo_read_t;
 typedef struct queue_schinfo_write_s queue_schinfo_write_t;
+typedef struct queue_span_s queue_span_t;
+typedef struct queue_seg_s queue_seg_t;
+typedef struct queue_stats_s queue_stats_t;
+
+/*
+ * Queue statistics, only kept with OSPORT_QUEUE_STATS
+ */
+struct queue_stats_s
+{
+	volatile uint_t max_used;             /* most bytes held at once */
+	volatile uint_t bytes_in;             /* bytes written           */
+	volatile uint_t bytes_out;            /* bytes read              */
+	volatile uint_t num_blocked_sends;    /* writers that blocked    */
+	volatile uint_t num_blocked_receives; /* readers that blocked    */
+	volatile uint_t blocked_time;         /* ticks spent blocked     */
+	volatile uint_t num_timeouts;         /* waits that failed       */
+};
 
 /*
  * Queue control block
@@ -53,14 +73,53 @@ struct queue_cblk_s
 	volatile uint_t size;            /* size of buffer      */
 	volatile uint_t read;            /* read index          */
 	volatile uint_t write;           /* write index         */
+	volatile uint_t reserve;         /* reserved up to      */
+	volatile uint_t acquire;         /* acquired up to      */
+	volatile uint_t num_reserved;    /* not committed yet   */
+	volatile uint_t num_acquired;    /* not released yet    */
+	volatile uint_t policy;          /* waiter service      */
+#if OSPORT_QUEUE_STATS
+	struct queue_stats_s stats;      /* statistics          */
+#endif
+};
+
+/*
+ * Span of queue buffer, the second part
+ * is used when the span wraps around
+ */
+struct queue_span_s
+{
+	byte_t *p_data[2]; /* start of each part */
+	uint_t size[2];    /* size of each part  */
+};
+
+/*
+ * Segment of a message held in a separate
+ * buffer, same layout as os_queue_seg_t
+ */
+struct queue_seg_s
+{
+	void *p_data; /* segment data */
+	uint_t size;  /* segment size */
 };
 
+/*
+ * Queue waiter service policy
+ */
+enum
+{
+	QUEUE_POLICY_HEAD_OF_LINE = 0,
+	QUEUE_POLICY_FIRST_FIT = 1
+} ;
+
 /*
  * Queue write wait flag
  */
 enum
 {
-	QUEUE_WRITE_AHEAD = (1<<0)
+	QUEUE_WRITE_AHEAD = (1<<0),
+	QUEUE_WRITE_RESERVE = (1<<1),
+	QUEUE_WRITE_VECTOR = (1<<2)
 } ;
 
 /*
@@ -68,7 +127,10 @@ enum
  */
 enum
 {
-	QUEUE_READ_PEEK = (1<<0)
+	QUEUE_READ_PEEK = (1<<0),
+	QUEUE_READ_ACQUIRE = (1<<1),
+	QUEUE_READ_STREAM = (1<<2),
+	QUEUE_READ_VECTOR = (1<<3)
 } ;
 
 /*
@@ -76,10 +138,17 @@ enum
  */
 struct queue_schinfo_read_s
 {
-	volatile bool_t result;               /* wait result */
-	volatile uint_t size;                 /* read size   */
-	byte_t *volatile p_data;              /* data        */
-	volatile uint_t flag;                 /* flag        */
+	volatile bool_t result;                   /* wait result */
+	volatile uint_t size;                     /* read size   */
+	byte_t *volatile p_data;                  /* data        */
+	volatile uint_t flag;                     /* flag        */
+	struct queue_span_s *volatile p_span;     /* acquired    */
+	volatile uint_t max;                      /* stream max  */
+	const struct queue_seg_s *volatile p_seg; /* segments    */
+	volatile uint_t num_seg;                  /* count       */
+#if OSPORT_QUEUE_STATS
+	volatile uint_t start;                    /* blocked at  */
+#endif
 };
 
 /*
@@ -87,10 +156,17 @@ struct queue_schinfo_read_s
  */
 struct queue_schinfo_write_s
 {
-	volatile bool_t result;                /* wait result */
-	volatile uint_t size;                  /* read size   */
-	const byte_t *volatile p_data;         /* data        */
-	volatile uint_t flag;                  /* flag        */
+	volatile bool_t result;                   /* wait result */
+	volatile uint_t size;                     /* read size   */
+	const byte_t *volatile p_data;            /* data        */
+	volatile uint_t flag;                     /* flag        */
+	struct queue_span_s *volatile p_span;     /* reserved    */
+	const struct queue_seg_s *volatile p_seg; /* segments    */
+	volatile uint_t num_seg;                  /* count       */
+	volatile uint_t prio;                     /* priority    */
+#if OSPORT_QUEUE_STATS
+	volatile uint_t start;                    /* blocked at  */
+#endif
 };
 
 #ifdef __cplusplus
@@ -107,11 +183,42 @@ UTIL_UNSAFE void queue_delete_static( queue_cblk_t *p_q, sch_cblk_t *p_sch );
 UTIL_UNSAFE void queue_write( queue_cblk_t *p_q, const byte_t *p_data, uint_t size );
 UTIL_UNSAFE void queue_write_ahead( queue_cblk_t *p_q, const byte_t *p_data, uint_t size );
 UTIL_UNSAFE void queue_read( queue_cblk_t *p_q, byte_t *p_data, uint_t size );
+UTIL_UNSAFE void queue_writev( queue_cblk_t *p_q, const queue_seg_t *p_seg, uint_t num );
+UTIL_UNSAFE void queue_readv( queue_cblk_t *p_q, const queue_seg_t *p_seg, uint_t num );
+UTIL_UNSAFE uint_t queue_get_seg_size( const queue_seg_t *p_seg, uint_t num );
 UTIL_UNSAFE void queue_peek( const queue_cblk_t *p_q, byte_t *p_data, uint_t size );
 UTIL_UNSAFE uint_t queue_get_used_size(const queue_cblk_t *p_q );
 UTIL_UNSAFE uint_t queue_get_free_size(const queue_cblk_t *p_q );
+UTIL_UNSAFE uint_t queue_get_ahead_size(const queue_cblk_t *p_q );
+UTIL_UNSAFE void queue_reserve( queue_cblk_t *p_q, uint_t size, queue_span_t *p_span );
+UTIL_UNSAFE bool_t queue_commit( queue_cblk_t *p_q );
+UTIL_UNSAFE void queue_acquire( queue_cblk_t *p_q, uint_t size, queue_span_t *p_span );
+UTIL_UNSAFE bool_t queue_release( queue_cblk_t *p_q );
+UTIL_UNSAFE void queue_write_handoff( queue_cblk_t *p_q, const byte_t *p_data, uint_t size, sch_cblk_t *p_sch );
+UTIL_UNSAFE bool_t queue_read_handoff( queue_cblk_t *p_q, byte_t *p_data, uint_t size, sch_cblk_t *p_sch );
 UTIL_UNSAFE void queue_unlock_threads( queue_cblk_t *p_q, sch_cblk_t *p_sch );
 
+/*
+ * Statistics, only available with OSPORT_QUEUE_STATS
+ */
+#if OSPORT_QUEUE_STATS
+UTIL_UNSAFE void queue_stats_in( queue_cblk_t *p_q, uint_t size );
+UTIL_UNSAFE void queue_stats_out( queue_cblk_t *p_q, uint_t size );
+#	define QUEUE_STATS_IN(P_Q, SIZE) \
+		queue_stats_in((P_Q), (SIZE))
+#	define QUEUE_STATS_OUT(P_Q, SIZE) \
+		queue_stats_out((P_Q), (SIZE))
+#	define QUEUE_STATS_WAKE(P_Q, P_INFO, P_SCH) \
+		((P_Q)->stats.blocked_time += (P_SCH)->timestamp - (P_INFO)->start)
+#else
+#	define QUEUE_STATS_IN(P_Q, SIZE) \
+		((void)0)
+#	define QUEUE_STATS_OUT(P_Q, SIZE) \
+		((void)0)
+#	define QUEUE_STATS_WAKE(P_Q, P_INFO, P_SCH) \
+		((void)0)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,73 @@
+/** ************************************************************************
+ * @file ring.h
+ * @brief Single-producer, single-consumer byte ring
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef H8E2F4C17_6A3B_4D95_B0C8_1F7A2E9D5B63
+#define H8E2F4C17_6A3B_4D95_B0C8_1F7A2E9D5B63
+
+#include "util.h"
+#include "thread.h"
+
+/*
+ * Type declarations
+ */
+struct ring_cblk_s;
+
+typedef struct ring_cblk_s ring_cblk_t;
+
+/*
+ * Ring control block, head is only written by the producer
+ * and tail only by the consumer, so neither needs a lock
+ */
+struct ring_cblk_s
+{
+	byte_t *volatile p_buffer;  /* ring memory buffer            */
+	struct sch_qprio_s q_wait;  /* waiting consumer              */
+	volatile uint_t size;       /* size of buffer                */
+	volatile uint_t head;       /* write index                   */
+	volatile uint_t tail;       /* read index                    */
+	volatile uint_t level;      /* bytes awaited, 0 if none      */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Ring functions
+ */
+UTIL_UNSAFE void ring_init( ring_cblk_t *p_ring, void *p_buffer, uint_t size );
+UTIL_UNSAFE void ring_delete_static( ring_cblk_t *p_ring, sch_cblk_t *p_sch );
+UTIL_SAFE uint_t ring_get_used_size( const ring_cblk_t *p_ring );
+UTIL_SAFE uint_t ring_write( ring_cblk_t *p_ring, const byte_t *p_data, uint_t size );
+UTIL_SAFE uint_t ring_read( ring_cblk_t *p_ring, byte_t *p_data, uint_t size );
+UTIL_UNSAFE void ring_notify( ring_cblk_t *p_ring, sch_cblk_t *p_sch );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H8E2F4C17_6A3B_4D95_B0C8_1F7A2E9D5B63 */
@@ -74,6 +74,7 @@ struct sch_qitem_s
 	struct thd_cblk_s *volatile p_thd;   /* thread                 */
 	void *volatile p_q;                  /* parent queue           */
 	volatile uint_t tag;                 /* tag value for ordering */
+	void *volatile p_schinfo;            /* scheduling info, if any */
 };
 
 /*
@@ -140,6 +141,9 @@ struct sch_cblk_s
 	struct sch_qprio_s q_delay2;                    /* delay queue 2           */
 	volatile uint_t timestamp;                      /* current time            */
 	volatile uint_t lock_depth;						/* lock nesting counter    */
+	volatile uint_t preempt_depth;                  /* preemption lock counter */
+	volatile bool_t preempt_pending;                /* reschedule postponed    */
+	struct sch_qfifo_s q_zombie;                    /* deleted threads         */
 };
 
 /*
@@ -155,6 +159,9 @@ struct thd_cblk_s
 	struct mlst_s mlst;				  /* memory list 			*/
 	void *volatile p_stack;			  /* stack memory 		    */
 	void *volatile p_schinfo;         /* scheduling info        */
+	void (*volatile p_timeout)(struct thd_cblk_s *p_thd); /* time out handler */
+	struct sch_qitem_s *volatile p_wait_items; /* extra wait items */
+	volatile uint_t num_wait_items;   /* number of extra items  */
 };
 
 #ifdef __cplusplus
@@ -174,6 +181,8 @@ UTIL_UNSAFE void sch_insert_delay( sch_cblk_t *p_sch, sch_qitem_t *p_item, uint_
 
 UTIL_SAFE void sch_lock_int( sch_cblk_t *p_sch );
 UTIL_SAFE void sch_unlock_int( sch_cblk_t *p_sch );
+UTIL_SAFE void sch_lock_preempt( sch_cblk_t *p_sch );
+UTIL_SAFE void sch_unlock_preempt( sch_cblk_t *p_sch );
 
 /*
  * Thread functions
@@ -184,6 +193,8 @@ UTIL_UNSAFE void thd_init( thd_cblk_t *p_thd, uint_t prio, void *p_stack,
 UTIL_UNSAFE void thd_ready(thd_cblk_t *p_thd, sch_cblk_t *p_sch);
 UTIL_UNSAFE void thd_block_current( sch_qprio_t *p_to, void *p_schinfo, uint_t timeout,
 		sch_cblk_t *p_sch );
+UTIL_UNSAFE void thd_block_current_cb( sch_qprio_t *p_to, void *p_schinfo, uint_t timeout,
+		void (*p_timeout)(thd_cblk_t *p_thd), sch_cblk_t *p_sch );
 
 /*
  * Internal thread creation and deletion
@@ -191,6 +202,7 @@ UTIL_UNSAFE void thd_block_current( sch_qprio_t *p_to, void *p_schinfo, uint_t t
 UTIL_UNSAFE void thd_create_static(thd_cblk_t *p_thd, uint_t prio, void *p_stack,
 		uint_t stack_size, void (*p_job)(void), sch_cblk_t *p_sch);
 UTIL_UNSAFE void thd_delete_static(thd_cblk_t *p_thd, sch_cblk_t *p_sch);
+UTIL_UNSAFE void thd_reclaim(sch_cblk_t *p_sch, mpool_t *p_mpool);
 
 UTIL_SAFE void thd_return_hook_static( void );
 UTIL_SAFE void thd_return_hook( void );
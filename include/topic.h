@@ -0,0 +1,102 @@
+/** ************************************************************************
+ * @file topic.h
+ * @brief Publish/subscribe topic
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef H3C91D6A2_7E45_4B18_A0F3_52B8E6C4D917
+#define H3C91D6A2_7E45_4B18_A0F3_52B8E6C4D917
+
+#include "util.h"
+#include "thread.h"
+#include "memory.h"
+#include "msgq.h"
+
+/*
+ * Type declarations
+ */
+struct topic_cblk_s;
+struct topic_sub_s;
+struct topic_msg_s;
+
+typedef struct topic_cblk_s topic_cblk_t;
+typedef struct topic_sub_s topic_sub_t;
+typedef struct topic_msg_s topic_msg_t;
+
+/*
+ * Topic control block
+ */
+struct topic_cblk_s
+{
+	struct topic_sub_s *volatile p_subs; /* subscriber list */
+};
+
+/*
+ * Subscriber, messages are queued to it as pointers
+ */
+struct topic_sub_s
+{
+	struct topic_sub_s *volatile p_next;   /* next subscriber     */
+	struct topic_cblk_s *volatile p_topic; /* topic subscribed to */
+	struct msgq_cblk_s msgq;               /* queued messages     */
+};
+
+/*
+ * Message header, the block returns to the pool
+ * when the last reference is released
+ */
+struct topic_msg_s
+{
+	volatile uint_t refs; /* reference count */
+};
+
+/*
+ * Aligned message header size
+ */
+#define TOPIC_MSG_HEADER_SIZE \
+	MPOOL_ALIGN(sizeof(topic_msg_t))
+
+/*
+ * Header of a message
+ */
+#define TOPIC_MSG_HEADER(P) \
+	((topic_msg_t*)((byte_t*)(P) - TOPIC_MSG_HEADER_SIZE))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Topic functions
+ */
+UTIL_UNSAFE void topic_init( topic_cblk_t *p_topic );
+UTIL_UNSAFE void topic_subscribe( topic_cblk_t *p_topic, topic_sub_t *p_sub, void *p_buffer, uint_t count );
+UTIL_UNSAFE void topic_unsubscribe( topic_sub_t *p_sub, sch_cblk_t *p_sch );
+UTIL_UNSAFE uint_t topic_publish( topic_cblk_t *p_topic, void *p_msg, sch_cblk_t *p_sch );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H3C91D6A2_7E45_4B18_A0F3_52B8E6C4D917 */
@@ -28,6 +28,7 @@
 #ifndef H7D9C202C_17FC_4683_B032_AC3425ABC5EC
 #define H7D9C202C_17FC_4683_B032_AC3425ABC5EC
 
+#include <stddef.h>
 #include "portable.h"
 
 #if OSPORT_ENABLE_DEBUG
@@ -44,6 +45,12 @@
 #define UTIL_UNLOCK_EVERYTHING() \
 	util_eint_nested()
 
+/*
+ * Obtain the structure from a pointer to one of its members
+ */
+#define UTIL_CONTAINER_OF(P, TYPE, MEMBER) \
+	((TYPE*)((byte_t*)(P) - offsetof(TYPE, MEMBER)))
+
 #define UTIL_UNSAFE	/* unsafe in a preemptive context */
 #define UTIL_SAFE	/* safe in a preemptive context */
 
@@ -58,6 +65,7 @@ extern "C" {
 
 void util_dint_nested( void );
 void util_eint_nested( void );
+void util_copy( void *p_dst, const void *p_src, uint_t size );
 
 #ifdef __cplusplus
 }
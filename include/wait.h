@@ -0,0 +1,81 @@
+/** ************************************************************************
+ * @file wait.h
+ * @brief Waiting on several kernel objects
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#ifndef H3C7D2E94_1B6A_4F08_8D5E_A42F9C1B7E30
+#define H3C7D2E94_1B6A_4F08_8D5E_A42F9C1B7E30
+
+#include "util.h"
+#include "thread.h"
+#include "semaphore.h"
+#include "mutex.h"
+#include "queue.h"
+
+/*
+ * Type declarations
+ */
+union wait_schinfo_u;
+
+typedef union wait_schinfo_u wait_schinfo_t;
+
+/*
+ * Kind of object waited on
+ */
+typedef enum
+{
+	WAIT_SEMAPHORE = 0, /* semaphore counter above zero      */
+	WAIT_MUTEX,         /* mutex available to the waiter     */
+	WAIT_QUEUE,         /* queue holds enough bytes          */
+	WAIT_MSGQ           /* message queue holds an item       */
+} wait_type_t;
+
+/*
+ * Scheduling info of one wait item, matching the
+ * object the item is queued on
+ */
+union wait_schinfo_u
+{
+	sem_schinfo_t sem;          /* semaphore peek     */
+	mutex_schinfo_t mutex;      /* mutex peek         */
+	queue_schinfo_read_t queue; /* queue or msgq peek */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Wait functions
+ */
+UTIL_UNSAFE bool_t wait_is_ready( uint_t type, handle_t h_object, uint_t size, const sch_cblk_t *p_sch );
+UTIL_UNSAFE sch_qprio_t *wait_prepare( uint_t type, handle_t h_object, uint_t size, wait_schinfo_t *p_schinfo );
+UTIL_UNSAFE bool_t wait_get_result( uint_t type, const wait_schinfo_t *p_schinfo );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H3C7D2E94_1B6A_4F08_8D5E_A42F9C1B7E30 */
@@ -32,11 +32,18 @@
 #include "include/util.h"
 #include "include/list.h"
 #include "include/memory.h"
+#include "include/arena.h"
 #include "include/global.h"
 #include "include/thread.h"
 #include "include/semaphore.h"
 #include "include/mutex.h"
 #include "include/queue.h"
+#include "include/msgq.h"
+#include "include/pmsgq.h"
+#include "include/objq.h"
+#include "include/ring.h"
+#include "include/topic.h"
+#include "include/wait.h"
 #include "include/api.h"
 
 #endif /* H10443F26_8333_43E2_ACCD_FC9E34241DE7 */
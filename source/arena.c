@@ -0,0 +1,258 @@
+/** ************************************************************************
+ * @file arena.c
+ * @brief Arena allocator
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#include "../include/arena.h"
+#include "../include/memory.h"
+#include "../include/global.h"
+#include "../include/api.h"
+
+/*
+ * Aligned arena control block size
+ */
+#define ARENA_CBLK_SIZE \
+	MPOOL_ALIGN(sizeof(arena_cblk_t))
+
+/*
+ * Initialize an arena
+ */
+UTIL_UNSAFE
+void arena_init( arena_cblk_t *p_arena, void *p_buffer, uint_t size )
+{
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_arena or p_buffer
+	 */
+	UTIL_ASSERT( p_arena != NULL );
+	UTIL_ASSERT( p_buffer != NULL );
+
+	/*
+	 * If failed:
+	 * Buffer not aligned
+	 */
+	UTIL_ASSERT( ((handle_t)p_buffer % OSPORT_MEM_ALIGN) == 0 );
+
+	p_arena->p_buffer = (byte_t*)p_buffer;
+	p_arena->size = size;
+	p_arena->used = 0;
+}
+
+/*
+ * Allocate from an arena by bumping the allocated size
+ */
+UTIL_UNSAFE
+void *arena_alloc( arena_cblk_t *p_arena, uint_t size )
+{
+	void *p_ret = NULL;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_arena
+	 */
+	UTIL_ASSERT( p_arena != NULL );
+
+	/*
+	 * If failed:
+	 * Corrupted arena
+	 */
+	UTIL_ASSERT( p_arena->used <= p_arena->size );
+
+	/* written to avoid overflowing on large requests */
+	if( size <= MPOOL_SIZE_MAX )
+		size = MPOOL_ALIGN(size);
+
+	if( (size <= MPOOL_SIZE_MAX) && (size <= p_arena->size - p_arena->used) )
+	{
+		p_ret = p_arena->p_buffer + p_arena->used;
+		p_arena->used += size;
+	}
+
+	return p_ret;
+}
+
+/*
+ * Release all allocations in an arena
+ */
+UTIL_UNSAFE
+void arena_reset( arena_cblk_t *p_arena )
+{
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_arena
+	 */
+	UTIL_ASSERT( p_arena != NULL );
+
+	p_arena->used = 0;
+}
+
+/**
+ * @brief Creates an arena
+ * @param size size of the arena, the total size of allocations it can hold
+ * @retval 0 arena creation failed because of low memory
+ * @retval !0 handle to the created arena
+ * @details An arena is a single memory block from the system pool that
+ * serves many small allocations with a bump pointer. Allocations from an
+ * arena carry no header and cannot be freed individually, instead, all of
+ * them are released at once by @ref os_arena_reset or @ref os_arena_delete.
+ * Every allocation is aligned, so the number of allocations an arena can
+ * hold depends on the alignment of the platform.
+ *
+ * The arena is charged to the calling thread like memory allocated by
+ * @ref os_memory_allocate, and will be recycled automatically upon thread
+ * deletion.
+ * @note This function can only be called in a thread context.
+ */
+UTIL_SAFE
+os_handle_t os_arena_create( os_uint_t size )
+{
+	arena_cblk_t *p_arena = NULL;
+
+	/* the control block is added to the size */
+	if( size <= MPOOL_SIZE_MAX - ARENA_CBLK_SIZE )
+		p_arena = mpool_lock_alloc( ARENA_CBLK_SIZE + size, &g_mpool,
+				&g_sch.p_current->mlst, MPOOL_TRANSIENT, &g_sch );
+
+	if( p_arena != NULL )
+	{
+		MPOOL_TAG( p_arena, OSPORT_CALLER_ADDRESS() );
+
+		UTIL_LOCK_EVERYTHING();
+		arena_init( p_arena, (byte_t*)p_arena + ARENA_CBLK_SIZE, size );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return (os_handle_t)p_arena;
+}
+
+/**
+ * @brief Deletes an arena
+ * @param h_arena handle to an arena
+ * @details All memory allocated from the arena is released together
+ * with the arena.
+ * @note This function is thread safe and can be used in a thread or
+ * interrupt context.
+ */
+UTIL_SAFE
+void os_arena_delete( os_handle_t h_arena )
+{
+	arena_cblk_t *p_arena;
+
+	p_arena = (arena_cblk_t*)h_arena;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_arena
+	 */
+	UTIL_ASSERT( p_arena != NULL );
+
+	mpool_lock_free( p_arena, &g_mpool, &g_sch );
+}
+
+/**
+ * @brief Allocates memory from an arena
+ * @param h_arena handle to an arena
+ * @param size requested size
+ * @retval !NULL allocation successful
+ * @retval NULL allocation failed because the arena is full
+ * @details Allocation takes constant time and the returned address is
+ * aligned. The memory cannot be freed individually, see @ref os_arena_reset.
+ * @note This function is thread safe and can be used in a thread or
+ * interrupt context.
+ */
+UTIL_SAFE
+void *os_arena_allocate( os_handle_t h_arena, os_uint_t size )
+{
+	arena_cblk_t *p_arena;
+	void *p_ret;
+
+	p_arena = (arena_cblk_t*)h_arena;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_arena
+	 */
+	UTIL_ASSERT( p_arena != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	p_ret = arena_alloc( p_arena, size );
+	UTIL_UNLOCK_EVERYTHING();
+
+	return p_ret;
+}
+
+/**
+ * @brief Releases all memory allocated from an arena
+ * @param h_arena handle to an arena
+ * @details Takes constant time regardless of the number of allocations.
+ * Memory previously allocated from the arena must not be accessed again.
+ * @note This function is thread safe and can be used in a thread or
+ * interrupt context.
+ */
+UTIL_SAFE
+void os_arena_reset( os_handle_t h_arena )
+{
+	arena_cblk_t *p_arena;
+
+	p_arena = (arena_cblk_t*)h_arena;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_arena
+	 */
+	UTIL_ASSERT( p_arena != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	arena_reset( p_arena );
+	UTIL_UNLOCK_EVERYTHING();
+}
+
+/**
+ * @brief Gets the size that can still be allocated from an arena
+ * @param h_arena handle to an arena
+ * @return free size of the arena
+ * @note This function is thread safe and can be used in a thread or
+ * interrupt context.
+ */
+UTIL_SAFE
+os_uint_t os_arena_get_free_size( os_handle_t h_arena )
+{
+	arena_cblk_t *p_arena;
+	uint_t ret;
+
+	p_arena = (arena_cblk_t*)h_arena;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_arena
+	 */
+	UTIL_ASSERT( p_arena != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	ret = p_arena->size - p_arena->used;
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
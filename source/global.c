@@ -85,8 +85,7 @@ void os_init( const os_config_t *p_config )
 	sch_init(&g_sch);
 
 	/* create pool memory */
-	mblk_init( (mblk_t*)p_config->p_pool_mem, p_config->pool_size );
-	mpool_insert( (mblk_t*)p_config->p_pool_mem, &g_mpool);
+	mpool_add( p_config->p_pool_mem, p_config->pool_size, &g_mpool );
 
 	/* initialize idle thread */
 	thd_init( &thd_idle, (OSPORT_NUM_PRIOS-1), thd_idle_stack,
@@ -27,40 +27,191 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *****************************************************************************/
+#include <stddef.h>
 #include "../include/memory.h"
 #include "../include/list.h"
 #include "../include/global.h"
+#include "../include/semaphore.h"
 
 /*
- * Check the alignment of a size or address
+ * Aligned memory block header size, compact headers end
+ * where the free block links start
  */
-#define MPOOL_IS_ALIGNED(VAL)  \
-	(((handle_t)(VAL) % OSPORT_MEM_ALIGN) == 0)
+#if OSPORT_MEM_COMPACT
+#	define MBLK_HEADER_SIZE \
+		MPOOL_ALIGN(offsetof(mblk_t, p_prev))
+#else
+#	define MBLK_HEADER_SIZE \
+		MPOOL_ALIGN(sizeof(mblk_t))
+#endif
 
 /*
- * Align a memory block size
+ * Aligned smallest memory block size, the payload must be able to
+ * hold a link for deferred freeing, and a free block must be able
+ * to hold the complete header
  */
-#define MPOOL_ALIGN(VAL) \
-	(((VAL)%OSPORT_MEM_ALIGN)? \
-		((VAL)+OSPORT_MEM_ALIGN-(VAL)%OSPORT_MEM_ALIGN):(VAL))
+#define MBLK_SMALLEST_PAYLOAD \
+	((OSPORT_MEM_SMALLEST > sizeof(void*))? OSPORT_MEM_SMALLEST : sizeof(void*))
+
+#define MBLK_SMALLEST_SIZE \
+	MPOOL_ALIGN( (MBLK_HEADER_SIZE + MBLK_SMALLEST_PAYLOAD > sizeof(mblk_t))? \
+		(MBLK_HEADER_SIZE + MBLK_SMALLEST_PAYLOAD) : sizeof(mblk_t) )
 
 /*
- * Aligned memory block header size
+ * Guard word of a memory block header
  */
-#define MBLK_HEADER_SIZE \
-	MPOOL_ALIGN(sizeof(mblk_t))
+#define MBLK_GUARD(P_MBLK) \
+	((uint_t)(handle_t)(P_MBLK) ^ (uint_t)0x5AA5C33CUL)
 
 /*
- * Aligned smallest memory block size
+ * Check if an address is inside the pool memory
  */
-#define MBLK_SMALLEST_SIZE \
-	MPOOL_ALIGN(MBLK_HEADER_SIZE + OSPORT_MEM_SMALLEST)
+#define MPOOL_CONTAINS(P_MPOOL, P) \
+	(((os_byte_t*)(P) >= (os_byte_t*)(P_MPOOL)->p_start) && \
+	 ((os_byte_t*)(P) < (os_byte_t*)(P_MPOOL)->p_end))
+
+#if OSPORT_MEM_COMPACT
+/*
+ * Check if a memory block is free
+ */
+#	define MBLK_IS_FREE(P_MBLK) \
+		((P_MBLK)->owner == 0)
+
+/*
+ * Check if a memory block carries links, only free blocks do
+ */
+#	define MBLK_HAS_LINKS(P_MBLK) \
+		MBLK_IS_FREE(P_MBLK)
+
+/*
+ * Free block links, the links do not start the header
+ * so the generic list functions cannot be used
+ */
+#	define MBLK_LINK_INIT(P_MBLK) \
+		mblk_link_init(P_MBLK)
+
+#	define MBLK_PREPEND(P_MBLK, P_POS) \
+		mblk_prepend((P_MBLK), (P_POS))
+
+#	define MBLK_REMOVE(P_MBLK) \
+		mblk_remove(P_MBLK)
+
+/*
+ * Memory lists holding blocks, indexed by owner - 1
+ */
+static mlst_t *volatile mlst_owners[OSPORT_MEM_NUM_OWNERS];
+#else
+/*
+ * Check if a memory block is free
+ */
+#	define MBLK_IS_FREE(P_MBLK) \
+		((P_MBLK)->p_mlst == NULL)
+
+/*
+ * Check if a memory block carries links
+ */
+#	define MBLK_HAS_LINKS(P_MBLK) \
+		(true)
 
 /*
  * Convert memory block to base class lstitem_t
  */
-#define TO_LSTITEM(P_MBLK) \
-	((lstitem_t*)(P_MBLK))
+#	define TO_LSTITEM(P_MBLK) \
+		((lstitem_t*)(P_MBLK))
+
+/*
+ * Free block links
+ */
+#	define MBLK_LINK_INIT(P_MBLK) \
+		lstitem_init(TO_LSTITEM(P_MBLK))
+
+#	define MBLK_PREPEND(P_MBLK, P_POS) \
+		lstitem_prepend(TO_LSTITEM(P_MBLK), TO_LSTITEM(P_POS))
+
+#	define MBLK_REMOVE(P_MBLK) \
+		lstitem_remove(TO_LSTITEM(P_MBLK))
+#endif
+
+#if OSPORT_MEM_COMPACT
+/*
+ * Initialize the links of a free block
+ */
+UTIL_UNSAFE
+static void mblk_link_init( mblk_t *p_mblk )
+{
+	p_mblk->p_prev = p_mblk;
+	p_mblk->p_next = p_mblk;
+}
+
+/*
+ * Insert a free block before another
+ */
+UTIL_UNSAFE
+static void mblk_prepend( mblk_t *p_mblk, mblk_t *p_pos )
+{
+	/*
+	 * If failed:
+	 * Block corrupted, uninitialized, or already in pool
+	 */
+	UTIL_ASSERT( p_mblk->p_prev == p_mblk );
+	UTIL_ASSERT( p_mblk->p_next == p_mblk );
+
+	/*
+	 * If failed:
+	 * Pool corrupted (left side of p_pos)
+	 */
+	UTIL_ASSERT( p_pos->p_prev->p_next == p_pos );
+
+	p_mblk->p_prev = p_pos->p_prev;
+	p_mblk->p_next = p_pos;
+	p_pos->p_prev->p_next = p_mblk;
+	p_pos->p_prev = p_mblk;
+}
+
+/*
+ * Remove a free block from its neighbours
+ */
+UTIL_UNSAFE
+static void mblk_remove( mblk_t *p_mblk )
+{
+	/*
+	 * If failed:
+	 * Pool corrupted
+	 */
+	UTIL_ASSERT( p_mblk->p_prev->p_next == p_mblk );
+	UTIL_ASSERT( p_mblk->p_next->p_prev == p_mblk );
+
+	p_mblk->p_prev->p_next = p_mblk->p_next;
+	p_mblk->p_next->p_prev = p_mblk->p_prev;
+	p_mblk->p_next = p_mblk;
+	p_mblk->p_prev = p_mblk;
+}
+
+/*
+ * Give a memory list an owner index, lists only keep an index
+ * while they hold blocks
+ */
+UTIL_UNSAFE
+static bool_t mlst_attach( mlst_t *p_mlst )
+{
+	uint_t counter;
+
+	if( p_mlst->owner == 0 )
+	{
+		for( counter = 0; counter < OSPORT_MEM_NUM_OWNERS; counter++ )
+		{
+			if( mlst_owners[counter] == NULL )
+			{
+				mlst_owners[counter] = p_mlst;
+				p_mlst->owner = counter + 1;
+				break;
+			}
+		}
+	}
+
+	return p_mlst->owner != 0;
+}
+#endif
 
 /*
  * Initialize a memory block header
@@ -92,9 +243,23 @@ void mblk_init( mblk_t *p_mblk, uint_t size)
 	 */
 	UTIL_ASSERT( size >= MBLK_SMALLEST_SIZE );
 
-	lstitem_init(TO_LSTITEM(p_mblk));
+	MBLK_LINK_INIT(p_mblk);
 	p_mblk->size = size;
+
+#if OSPORT_MEM_COMPACT
+	p_mblk->owner = 0;
+#else
 	p_mblk->p_mlst = NULL;
+#endif
+
+#if OSPORT_MEM_TRACE
+	p_mblk->p_tag = NULL;
+	p_mblk->timestamp = 0;
+#endif
+
+#if OSPORT_MEM_GUARD
+	p_mblk->guard = MBLK_GUARD(p_mblk);
+#endif
 }
 
 /*
@@ -109,7 +274,13 @@ void mlst_init( mlst_t *p_mlst )
 	 */
 	UTIL_ASSERT( p_mlst != NULL );
 
+#if OSPORT_MEM_COMPACT
+	p_mlst->size = 0;
+	p_mlst->count = 0;
+	p_mlst->owner = 0;
+#else
 	p_mlst->p_head = NULL;
+#endif
 }
 
 /*
@@ -126,8 +297,131 @@ void mpool_init( mpool_t *p_mpool )
 
 	p_mpool->p_head = NULL;
 	p_mpool->p_alloc_head = NULL;
+	p_mpool->total_size = 0;
+	p_mpool->free_size = 0;
+	p_mpool->min_free_size = 0;
+	p_mpool->num_allocs = 0;
+	p_mpool->num_frees = 0;
+	p_mpool->num_failures = 0;
+	p_mpool->p_start = NULL;
+	p_mpool->p_end = NULL;
+	p_mpool->p_check = NULL;
+	p_mpool->p_corrupt = NULL;
+	p_mpool->max_scan = 0;
+	p_mpool->locked = false;
+	p_mpool->p_deferred = NULL;
+	p_mpool->low_size = 0;
+	p_mpool->critical_size = 0;
+	p_mpool->pressure = MPOOL_PRESSURE_NONE;
+	p_mpool->pressure_raised = false;
+	p_mpool->p_pressure_sem = NULL;
+}
+
+/*
+ * Add a region of memory to memory pool
+ */
+UTIL_UNSAFE
+void mpool_add( void *p_mem, uint_t size, mpool_t *p_mpool )
+{
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mem or p_mpool
+	 */
+	UTIL_ASSERT( p_mem != NULL );
+	UTIL_ASSERT( p_mpool != NULL );
+
+	/*
+	 * If failed:
+	 * Pool memory already added, only one continuous region
+	 * is supported
+	 */
+	UTIL_ASSERT( p_mpool->p_start == NULL );
+
+	mblk_init( (mblk_t*)p_mem, size );
+	mpool_insert( (mblk_t*)p_mem, p_mpool );
+
+	p_mpool->p_start = p_mem;
+	p_mpool->p_end = (os_byte_t*)p_mem + size;
+
+	p_mpool->total_size += size;
+	p_mpool->free_size += size;
+	p_mpool->min_free_size = p_mpool->free_size;
+}
+
+#if OSPORT_MEM_COMPACT
+/*
+ * Insert memory block into memory list
+ */
+UTIL_UNSAFE
+void mlst_insert( mblk_t *p_mblk, mlst_t *p_mlst )
+{
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mblk or p_mlst
+	 */
+	UTIL_ASSERT( p_mblk != NULL );
+	UTIL_ASSERT( p_mlst != NULL );
+
+	/*
+	 * If failed:
+	 * Block corrupted, uninitialized, or already in list
+	 */
+	UTIL_ASSERT( p_mblk->owner == 0 );
+
+	/*
+	 * If failed:
+	 * No owner index, mlst_attach not called or failed
+	 */
+	UTIL_ASSERT( p_mlst->owner != 0 );
+	UTIL_ASSERT( mlst_owners[p_mlst->owner - 1] == p_mlst );
+
+	p_mblk->owner = p_mlst->owner;
+	p_mlst->size += p_mblk->size;
+	p_mlst->count++;
 }
 
+/*
+ * Remove memory block from memory list
+ */
+UTIL_UNSAFE
+void mlst_remove( mblk_t *p_mblk )
+{
+	mlst_t *p_mlst;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mblk
+	 */
+	UTIL_ASSERT( p_mblk != NULL );
+
+	/*
+	 * If failed:
+	 * Block not in list, or corrupted owner index
+	 */
+	UTIL_ASSERT( p_mblk->owner != 0 );
+	UTIL_ASSERT( p_mblk->owner <= OSPORT_MEM_NUM_OWNERS );
+
+	p_mlst = mlst_owners[p_mblk->owner - 1];
+	p_mblk->owner = 0;
+
+	/*
+	 * If failed:
+	 * Owner index not in use, corrupted header
+	 */
+	UTIL_ASSERT( p_mlst != NULL );
+	UTIL_ASSERT( p_mlst->count > 0 );
+
+	p_mlst->size -= p_mblk->size;
+	p_mlst->count--;
+
+	/* release the owner index with the last block */
+	if( p_mlst->count == 0 )
+	{
+		mlst_owners[p_mlst->owner - 1] = NULL;
+		p_mlst->owner = 0;
+	}
+}
+#else
 /*
  * Insert memory block into memory list
  */
@@ -216,6 +510,7 @@ void mlst_remove( mblk_t *p_mblk )
 		lstitem_remove(TO_LSTITEM(p_mblk));
 	}
 }
+#endif
 
 /*
  * Insert memory block into memory pool
@@ -236,7 +531,7 @@ void mpool_insert( mblk_t *p_mblk, mpool_t *p_mpool )
 	 * If failed:
 	 * Block not removed from list
 	 */
-	UTIL_ASSERT( p_mblk->p_mlst == NULL );
+	UTIL_ASSERT( MBLK_IS_FREE(p_mblk) );
 
 	/* inserting first block */
 	if( p_mpool->p_head == NULL )
@@ -255,13 +550,13 @@ void mpool_insert( mblk_t *p_mblk, mpool_t *p_mpool )
 	else if( p_mblk < p_mpool->p_head )
 	{
 		/* insert as first block */
-		lstitem_prepend(TO_LSTITEM(p_mblk), TO_LSTITEM(p_mpool->p_head));
+		MBLK_PREPEND(p_mblk, p_mpool->p_head);
 		p_mpool->p_head = p_mblk;
 	}
 	else if( p_mblk > p_mpool->p_head->p_prev )
 	{
 		/* insert as last block */
-		lstitem_prepend(TO_LSTITEM(p_mblk), TO_LSTITEM(p_mpool->p_head));
+		MBLK_PREPEND(p_mblk, p_mpool->p_head);
 	}
 	else
 	{
@@ -282,7 +577,7 @@ void mpool_insert( mblk_t *p_mblk, mpool_t *p_mpool )
 			if( p_mblk < p_i )
 			{
 				/* insert before found block */
-				lstitem_prepend( TO_LSTITEM(p_mblk), TO_LSTITEM(p_i));
+				MBLK_PREPEND(p_mblk, p_i);
 				break;
 			}
 
@@ -309,7 +604,7 @@ void mpool_remove( mblk_t *p_mblk, mpool_t *p_mpool )
 	 * If failed:
 	 * Removing from pool, but block seems to be in list
 	 */
-	UTIL_ASSERT( p_mblk->p_mlst == NULL );
+	UTIL_ASSERT( MBLK_IS_FREE(p_mblk) );
 
 	/* removing only item */
 	if( p_mblk == p_mblk->p_next )
@@ -351,7 +646,7 @@ void mpool_remove( mblk_t *p_mblk, mpool_t *p_mpool )
 			p_mpool->p_alloc_head = p_mpool->p_alloc_head->p_next;
 		}
 
-		lstitem_remove(TO_LSTITEM(p_mblk));
+		MBLK_REMOVE(p_mblk);
 	}
 }
 
@@ -419,6 +714,10 @@ void mpool_merge( mblk_t *p_mblk, mpool_t *p_mpool )
 	/* merge with next block */
 	if( (os_byte_t*)p_mblk + p_mblk->size == (os_byte_t*)p_mblk->p_next  )
 	{
+		/* integrity check must not stop at a vanishing header */
+		if( p_mpool->p_check == p_mblk->p_next )
+			p_mpool->p_check = p_mblk;
+
 		p_mblk->size += p_mblk->p_next->size;
 		mpool_remove( p_mblk->p_next, p_mpool );
 	}
@@ -426,157 +725,843 @@ void mpool_merge( mblk_t *p_mblk, mpool_t *p_mpool )
 	/* merge with previous block */
 	if( (os_byte_t*)p_mblk == (os_byte_t*) p_mblk->p_prev + p_mblk->p_prev->size )
 	{
+		if( p_mpool->p_check == p_mblk )
+			p_mpool->p_check = p_mblk->p_prev;
+
 		p_mblk->p_prev->size += p_mblk->size;
 		mpool_remove( p_mblk, p_mpool );
 	}
 }
 
 /*
- * Allocate memory from memory pool
+ * Find a free block of at least size bytes using the configured
+ * placement policy, returns NULL if none found
  */
 UTIL_UNSAFE
-void *mpool_alloc( uint_t size, mpool_t *p_mpool, mlst_t *p_mlst )
+static mblk_t *mpool_find( uint_t size, mpool_t *p_mpool )
 {
-	mblk_t *p_i;
-	void *p_ret;
+	mblk_t *p_i, *p_start, *p_ret = NULL;
+	uint_t scan = 0;
+
+	/* skip if memory pool is empty */
+	if( p_mpool->p_head == NULL )
+		return NULL;
 
 	/*
 	 * If failed:
-	 * NULL pointer passed to p_mpool or p_mlst
+	 * p_head indicates the pool is not empty, but
+	 * p_alloc_head indicates otherwise.
+	 * Corrupted or uninitialized pool.
 	 */
-	UTIL_ASSERT( p_mpool != NULL );
-	UTIL_ASSERT( p_mlst != NULL );
+	UTIL_ASSERT( p_mpool->p_alloc_head != NULL );
 
-	p_ret = NULL;
+#if OSPORT_MEM_POLICY == OSPORT_MEM_NEXT_FIT
+	/* start searching from current block */
+	p_start = p_mpool->p_alloc_head;
+#else
+	/* start searching from lowest address */
+	p_start = p_mpool->p_head;
+#endif
 
-	/* skip if memory pool is empty */
-	if( p_mpool->p_head != NULL )
+	p_i = p_start;
+
+	do
 	{
 		/*
 		 * If failed:
-		 * p_head indicates the pool is not empty, but
-		 * p_alloc_head indicates otherwise.
-		 * Corrupted or uninitialized pool.
+		 * Broken link
 		 */
-		UTIL_ASSERT( p_mpool->p_alloc_head != NULL );
-
-		/* calculate and align the block size */
-		size = MPOOL_ALIGN(size + MBLK_HEADER_SIZE);
-		if( size < MBLK_SMALLEST_SIZE )
-			size = MBLK_SMALLEST_SIZE;
+		UTIL_ASSERT( p_i != NULL );
+		UTIL_ASSERT( p_i->p_next != NULL );
+		UTIL_ASSERT( p_i->p_next->p_prev == p_i );
 
-		/* start searching from current block */
-		p_i = p_mpool->p_alloc_head;
+		scan++;
 
-		do
+		/* encounter a large block */
+		if( size <= p_i->size )
 		{
-			/*
-			 * If failed:
-			 * Broken link
-			 */
-			UTIL_ASSERT( p_i != NULL );
-			UTIL_ASSERT( p_i->p_next != NULL );
-			UTIL_ASSERT( p_i->p_next->p_prev == p_i );
-
-			/* encounter a large block */
-			if( size <= p_i->size )
-			{
-				/* update allocation head pointer */
-				p_mpool->p_alloc_head = p_i->p_next;
-
-				/* split the block when possible */
-				if( size + MBLK_SMALLEST_SIZE <= p_i->size )
-				{
-					mpool_split( p_i, size, p_mpool );
-				}
-
-				mpool_remove(p_i, p_mpool);
-				mlst_insert(p_i, p_mlst );
-				p_ret = (os_byte_t*)p_i + MBLK_HEADER_SIZE;
+#if OSPORT_MEM_POLICY == OSPORT_MEM_BEST_FIT
+			/* keep the smallest block, stop at exact fit */
+			if( (p_ret == NULL) || (p_i->size < p_ret->size) )
+				p_ret = p_i;
 
+			if( p_i->size == size )
 				break;
-			}
+#else
+			p_ret = p_i;
+			break;
+#endif
+		}
 
-			p_i = p_i->p_next;
+		p_i = p_i->p_next;
 
-		} while( p_i != p_mpool->p_alloc_head );
-	}
+	} while( p_i != p_start );
+
+	if( scan > p_mpool->max_scan )
+		p_mpool->max_scan = scan;
 
 	return p_ret;
 }
 
 /*
- * Free memory and return to pool
+ * Find the highest free block that fits, searching down from the
+ * end of the pool
  */
 UTIL_UNSAFE
-void mpool_free( void *p, mpool_t *p_mpool )
+static mblk_t *mpool_find_high( uint_t size, mpool_t *p_mpool )
 {
-	mblk_t *p_mblk;
+	mblk_t *p_i, *p_ret = NULL;
+	uint_t scan = 0;
 
-	/*
-	 * If failed:
-	 * NULL pointer passed to p, p_mlst or p_mpool
-	 */
-	UTIL_ASSERT( p != NULL );
-	UTIL_ASSERT( p_mpool != NULL );
+	/* skip if memory pool is empty */
+	if( p_mpool->p_head == NULL )
+		return NULL;
 
-	/*
-	 * If failed:
-	 * p unaligned
-	 */
-	UTIL_ASSERT( MPOOL_IS_ALIGNED(p) );
+	/* start searching from highest address */
+	p_i = p_mpool->p_head->p_prev;
 
-	p_mblk = (mblk_t*)( (os_byte_t*)p - MBLK_HEADER_SIZE );
+	do
+	{
+		/*
+		 * If failed:
+		 * Broken link
+		 */
+		UTIL_ASSERT( p_i != NULL );
+		UTIL_ASSERT( p_i->p_prev != NULL );
+		UTIL_ASSERT( p_i->p_prev->p_next == p_i );
 
-	/*
-	 * If failed:
-	 * Unaligned size or broken link
-	 * Corrupted header
-	 */
-	UTIL_ASSERT( MPOOL_IS_ALIGNED(p_mblk->size) );
-	UTIL_ASSERT( p_mblk->p_prev != NULL );
-	UTIL_ASSERT( p_mblk->p_next != NULL );
-	UTIL_ASSERT( p_mblk->p_mlst != NULL );
+		scan++;
 
-	mlst_remove( p_mblk );
-	mpool_insert( p_mblk, p_mpool );
-	mpool_merge( p_mblk, p_mpool );
+		if( size <= p_i->size )
+		{
+			p_ret = p_i;
+			break;
+		}
+
+		p_i = p_i->p_prev;
+
+	} while( p_i != p_mpool->p_head->p_prev );
+
+	if( scan > p_mpool->max_scan )
+		p_mpool->max_scan = scan;
+
+	return p_ret;
 }
 
 /*
- * Gather memory block information
+ * Memory pressure level of the current free size
  */
 UTIL_UNSAFE
-void mblk_gather_info( const mblk_t *p_mblk, mblk_info_t *p_info)
+static uint_t mpool_pressure( const mpool_t *p_mpool )
 {
-	/*
-	 * If failed:
-	 * Invalid parameters
-	 */
-	UTIL_ASSERT( p_mblk != NULL );
-	UTIL_ASSERT( p_info != NULL );
+	uint_t ret;
 
-	p_info->size = p_mblk->size;
+	if( p_mpool->free_size < p_mpool->critical_size )
+		ret = MPOOL_PRESSURE_CRITICAL;
+	else if( p_mpool->free_size < p_mpool->low_size )
+		ret = MPOOL_PRESSURE_LOW;
+	else
+		ret = MPOOL_PRESSURE_NONE;
+
+	return ret;
 }
 
 /*
- * Gather memory list information
+ * Raise the memory pressure level, the pressure semaphore
+ * is posted when the pool is unlocked
  */
 UTIL_UNSAFE
-void mlst_gather_info( const mlst_t *p_mlst, mlst_info_t *p_info)
+static void mpool_raise_pressure( uint_t level, mpool_t *p_mpool )
 {
-	mblk_t *p_i;
-	uint_t count = 0, size = 0;
+	if( level > p_mpool->pressure )
+	{
+		p_mpool->pressure = level;
+		p_mpool->pressure_raised = true;
+	}
+}
+
+/*
+ * Allocate memory from memory pool
+ */
+UTIL_UNSAFE
+void *mpool_alloc( uint_t size, mpool_t *p_mpool, mlst_t *p_mlst, mpool_hint_t hint )
+{
+	mblk_t *p_mblk;
+	void *p_ret = NULL;
 
 	/*
 	 * If failed:
-	 * Invalid parameters
+	 * NULL pointer passed to p_mpool or p_mlst
 	 */
+	UTIL_ASSERT( p_mpool != NULL );
 	UTIL_ASSERT( p_mlst != NULL );
-	UTIL_ASSERT( p_info != NULL );
 
-	if( p_mlst->p_head != NULL )
-	{
+	/* calculate and align the block size */
+	if( size <= MPOOL_SIZE_MAX - MBLK_HEADER_SIZE )
+		size = MPOOL_ALIGN(size + MBLK_HEADER_SIZE);
+	else
+		size = 0;
+
+	if( (size != 0) && (size < MBLK_SMALLEST_SIZE) )
+		size = MBLK_SMALLEST_SIZE;
+
+	/* too large to be aligned */
+	if( size == 0 )
+		p_mblk = NULL;
+	else if( hint == MPOOL_LONG_LIVED )
+		p_mblk = mpool_find_high( size, p_mpool );
+	else
+		p_mblk = mpool_find( size, p_mpool );
+
+#if OSPORT_MEM_COMPACT
+	/* only a list given a block holds an index, fails when all are in use */
+	if( (p_mblk != NULL) && !mlst_attach(p_mlst) )
+		p_mblk = NULL;
+#endif
+
+	if( p_mblk != NULL )
+	{
+		if( hint == MPOOL_LONG_LIVED )
+		{
+			/* split the block when possible, allocating the upper part */
+			if( size + MBLK_SMALLEST_SIZE <= p_mblk->size )
+			{
+				mpool_split( p_mblk, p_mblk->size - size, p_mpool );
+				p_mblk = p_mblk->p_next;
+			}
+		}
+		else
+		{
+			/* update allocation head pointer */
+			p_mpool->p_alloc_head = p_mblk->p_next;
+
+			/* split the block when possible */
+			if( size + MBLK_SMALLEST_SIZE <= p_mblk->size )
+			{
+				mpool_split( p_mblk, size, p_mpool );
+			}
+		}
+
+		mpool_remove(p_mblk, p_mpool);
+		mlst_insert(p_mblk, p_mlst );
+		p_ret = (os_byte_t*)p_mblk + MBLK_HEADER_SIZE;
+
+#if OSPORT_MEM_TRACE
+		p_mblk->p_tag = NULL;
+		p_mblk->timestamp = g_sch.timestamp;
+#endif
+
+		/* update statistics */
+		p_mpool->free_size -= p_mblk->size;
+		p_mpool->num_allocs++;
+
+		if( p_mpool->free_size < p_mpool->min_free_size )
+			p_mpool->min_free_size = p_mpool->free_size;
+
+		mpool_raise_pressure( mpool_pressure(p_mpool), p_mpool );
+	}
+	else
+	{
+		p_mpool->num_failures++;
+		mpool_raise_pressure( MPOOL_PRESSURE_CRITICAL, p_mpool );
+	}
+
+	return p_ret;
+}
+
+/*
+ * Return a block removed from its memory list to pool
+ */
+UTIL_UNSAFE
+static void mpool_put( mblk_t *p_mblk, mpool_t *p_mpool )
+{
+	/* update statistics before the block gets merged */
+	p_mpool->free_size += p_mblk->size;
+	p_mpool->num_frees++;
+
+	/* pressure eases as memory returns */
+	if( mpool_pressure(p_mpool) < p_mpool->pressure )
+		p_mpool->pressure = mpool_pressure(p_mpool);
+
+#if OSPORT_MEM_COMPACT
+	/* links were overlaid by the payload */
+	MBLK_LINK_INIT(p_mblk);
+#endif
+
+	mpool_insert( p_mblk, p_mpool );
+	mpool_merge( p_mblk, p_mpool );
+}
+
+/*
+ * Free memory and return to pool
+ */
+UTIL_UNSAFE
+void mpool_free( void *p, mpool_t *p_mpool )
+{
+	mblk_t *p_mblk;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p, p_mlst or p_mpool
+	 */
+	UTIL_ASSERT( p != NULL );
+	UTIL_ASSERT( p_mpool != NULL );
+
+	/*
+	 * If failed:
+	 * p unaligned
+	 */
+	UTIL_ASSERT( MPOOL_IS_ALIGNED(p) );
+
+	p_mblk = (mblk_t*)( (os_byte_t*)p - MBLK_HEADER_SIZE );
+
+	/*
+	 * If failed:
+	 * Unaligned size or broken link
+	 * Corrupted header
+	 */
+	UTIL_ASSERT( MPOOL_IS_ALIGNED(p_mblk->size) );
+	UTIL_ASSERT( !MBLK_IS_FREE(p_mblk) );
+
+#if !OSPORT_MEM_COMPACT
+	UTIL_ASSERT( p_mblk->p_prev != NULL );
+	UTIL_ASSERT( p_mblk->p_next != NULL );
+#endif
+
+#if OSPORT_MEM_GUARD
+	/*
+	 * If failed:
+	 * Header overwritten, or p not returned by mpool_alloc
+	 */
+	UTIL_ASSERT( p_mblk->guard == MBLK_GUARD(p_mblk) );
+#endif
+
+	mlst_remove( p_mblk );
+	mpool_put( p_mblk, p_mpool );
+}
+
+#if OSPORT_MEM_COMPACT
+/*
+ * Free all memory in a memory list and return to pool, compact lists
+ * do not link their blocks so the pool is walked in address order
+ */
+UTIL_UNSAFE
+void mpool_reclaim( mlst_t *p_mlst, mpool_t *p_mpool )
+{
+	mblk_t *p_mblk, *p_next, *p_self = NULL;
+	uint_t owner;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mlst or p_mpool
+	 */
+	UTIL_ASSERT( p_mlst != NULL );
+	UTIL_ASSERT( p_mpool != NULL );
+
+	owner = p_mlst->owner;
+	p_mblk = (mblk_t*)p_mpool->p_start;
+
+	/* an index held without blocks is released here, nothing to walk */
+	if( (owner != 0) && (p_mlst->count == 0) )
+	{
+		mlst_owners[owner - 1] = NULL;
+		p_mlst->owner = 0;
+		owner = 0;
+	}
+
+	while( (owner != 0) && ((os_byte_t*)p_mblk < (os_byte_t*)p_mpool->p_end) )
+	{
+		/*
+		 * If failed:
+		 * Corrupted block size
+		 */
+		UTIL_ASSERT( p_mblk->size != 0 );
+		UTIL_ASSERT( MPOOL_IS_ALIGNED(p_mblk->size) );
+
+		p_next = (mblk_t*)( (os_byte_t*)p_mblk + p_mblk->size );
+
+		if( p_mblk->owner == owner )
+		{
+			/* the list header may live in one of its own blocks */
+			if( ((os_byte_t*)p_mlst >= (os_byte_t*)p_mblk) &&
+				((os_byte_t*)p_mlst < (os_byte_t*)p_next) )
+				p_self = p_mblk;
+			else
+			{
+				/* a free neighbour is merged into the freed block */
+				if( ((os_byte_t*)p_next < (os_byte_t*)p_mpool->p_end) &&
+					MBLK_IS_FREE(p_next) )
+					p_next = (mblk_t*)( (os_byte_t*)p_next + p_next->size );
+
+				mlst_remove( p_mblk );
+				mpool_put( p_mblk, p_mpool );
+			}
+		}
+
+		p_mblk = p_next;
+	}
+
+	/* the header is no longer used, release its block last */
+	if( p_self != NULL )
+	{
+		mlst_remove( p_self );
+		mpool_put( p_self, p_mpool );
+	}
+}
+#else
+/*
+ * Free all memory in a memory list and return to pool
+ */
+UTIL_UNSAFE
+void mpool_reclaim( mlst_t *p_mlst, mpool_t *p_mpool )
+{
+	mblk_t *p_mblk, *p_self = NULL;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mlst or p_mpool
+	 */
+	UTIL_ASSERT( p_mlst != NULL );
+	UTIL_ASSERT( p_mpool != NULL );
+
+	while( p_mlst->p_head != NULL )
+	{
+		p_mblk = p_mlst->p_head;
+		mlst_remove( p_mblk );
+
+		/* the list header may live in one of its own blocks */
+		if( ((os_byte_t*)p_mlst >= (os_byte_t*)p_mblk) &&
+			((os_byte_t*)p_mlst < (os_byte_t*)p_mblk + p_mblk->size) )
+			p_self = p_mblk;
+		else
+			mpool_put( p_mblk, p_mpool );
+	}
+
+	/* the header is no longer used, release its block last */
+	if( p_self != NULL )
+		mpool_put( p_self, p_mpool );
+}
+#endif
+
+/*
+ * Move allocated memory to another memory list, only fails
+ * when the list cannot be given an owner index
+ */
+UTIL_UNSAFE
+bool_t mpool_transfer( void *p, mlst_t *p_mlst )
+{
+	mblk_t *p_mblk;
+	bool_t ret = true;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p or p_mlst
+	 */
+	UTIL_ASSERT( p != NULL );
+	UTIL_ASSERT( p_mlst != NULL );
+
+	p_mblk = (mblk_t*)( (os_byte_t*)p - MBLK_HEADER_SIZE );
+
+	/*
+	 * If failed:
+	 * Memory not allocated
+	 */
+	UTIL_ASSERT( !MBLK_IS_FREE(p_mblk) );
+
+#if OSPORT_MEM_COMPACT
+	/* fails when all owner indices are in use */
+	ret = mlst_attach( p_mlst );
+#endif
+
+	if( ret )
+	{
+		mlst_remove( p_mblk );
+		mlst_insert( p_mblk, p_mlst );
+	}
+
+	return ret;
+}
+
+/*
+ * Try to lock the pool, only fails when an interrupt finds the pool in
+ * use by the code it interrupted. Preemption is disabled while the pool
+ * is locked, interrupts are not.
+ */
+UTIL_SAFE
+bool_t mpool_lock( mpool_t *p_mpool, sch_cblk_t *p_sch )
+{
+	bool_t ret = false;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mpool or p_sch
+	 */
+	UTIL_ASSERT( p_mpool != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+
+	if( !p_mpool->locked )
+	{
+		p_mpool->locked = true;
+		sch_lock_preempt( p_sch );
+		ret = true;
+	}
+
+	UTIL_UNLOCK_EVERYTHING();
+
+	/* deferred memory becomes available to the lock owner */
+	if( ret )
+		mpool_drain( p_mpool );
+
+	return ret;
+}
+
+/*
+ * Unlock the pool, the memory freed by interrupts and the memory of
+ * deleted threads are released before the lock is given up
+ */
+UTIL_SAFE
+void mpool_unlock( mpool_t *p_mpool, sch_cblk_t *p_sch )
+{
+	bool_t done;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mpool or p_sch
+	 */
+	UTIL_ASSERT( p_mpool != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	/*
+	 * If failed:
+	 * Trying to release a lock you do not own
+	 */
+	UTIL_ASSERT( p_mpool->locked );
+
+	thd_reclaim( p_sch, p_mpool );
+
+	do
+	{
+		mpool_drain( p_mpool );
+
+		/* nothing deferred meanwhile, give up the lock */
+		UTIL_LOCK_EVERYTHING();
+
+		done = (p_mpool->p_deferred == NULL);
+
+		if( done )
+		{
+			/* wake the pressure thread, runs once preemption is unlocked */
+			if( p_mpool->pressure_raised && (p_mpool->p_pressure_sem != NULL) )
+			{
+				p_mpool->pressure_raised = false;
+				sem_reset( p_mpool->p_pressure_sem, 1, p_sch );
+			}
+
+			p_mpool->locked = false;
+			sch_unlock_preempt( p_sch );
+		}
+
+		UTIL_UNLOCK_EVERYTHING();
+
+	} while( !done );
+}
+
+/*
+ * Defer freeing memory to the pool lock owner in constant time,
+ * the memory is linked through its payload. Lock-free when the
+ * port provides OSPORT_ATOMIC_CAS.
+ */
+UTIL_SAFE
+void mpool_defer( void *p, mpool_t *p_mpool )
+{
+#if defined(OSPORT_ATOMIC_CAS)
+	void *p_head;
+#endif
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p or p_mpool
+	 */
+	UTIL_ASSERT( p != NULL );
+	UTIL_ASSERT( p_mpool != NULL );
+
+#if defined(OSPORT_ATOMIC_CAS)
+	do
+	{
+		p_head = p_mpool->p_deferred;
+		*(void**)p = p_head;
+
+	} while( !OSPORT_ATOMIC_CAS( &p_mpool->p_deferred, p_head, p ) );
+#else
+	UTIL_LOCK_EVERYTHING();
+	*(void**)p = p_mpool->p_deferred;
+	p_mpool->p_deferred = p;
+	UTIL_UNLOCK_EVERYTHING();
+#endif
+}
+
+/*
+ * Free all deferred memory, the pool must be locked. The list is
+ * detached as a whole, so pushing never races with freeing.
+ */
+UTIL_UNSAFE
+void mpool_drain( mpool_t *p_mpool )
+{
+	void *p, *p_next;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mpool
+	 */
+	UTIL_ASSERT( p_mpool != NULL );
+
+#if defined(OSPORT_ATOMIC_CAS)
+	do
+	{
+		p = p_mpool->p_deferred;
+
+	} while( !OSPORT_ATOMIC_CAS( &p_mpool->p_deferred, p, NULL ) );
+#else
+	UTIL_LOCK_EVERYTHING();
+	p = p_mpool->p_deferred;
+	p_mpool->p_deferred = NULL;
+	UTIL_UNLOCK_EVERYTHING();
+#endif
+
+	while( p != NULL )
+	{
+		p_next = *(void**)p;
+		mpool_free( p, p_mpool );
+		p = p_next;
+	}
+}
+
+/*
+ * Lock the pool and allocate memory, fails when the pool is in use
+ */
+UTIL_SAFE
+void *mpool_lock_alloc( uint_t size, mpool_t *p_mpool, mlst_t *p_mlst, mpool_hint_t hint,
+		sch_cblk_t *p_sch )
+{
+	void *p_ret = NULL;
+
+	if( mpool_lock( p_mpool, p_sch ) )
+	{
+		p_ret = mpool_alloc( size, p_mpool, p_mlst, hint );
+		mpool_unlock( p_mpool, p_sch );
+	}
+
+	return p_ret;
+}
+
+/*
+ * Lock the pool and free memory, deferred when the pool is in use
+ */
+UTIL_SAFE
+void mpool_lock_free( void *p, mpool_t *p_mpool, sch_cblk_t *p_sch )
+{
+	if( mpool_lock( p_mpool, p_sch ) )
+	{
+		mpool_free( p, p_mpool );
+		mpool_unlock( p_mpool, p_sch );
+	}
+	else
+		mpool_defer( p, p_mpool );
+}
+
+#if OSPORT_MEM_TRACE
+/*
+ * Tag allocated memory with its call site
+ */
+UTIL_UNSAFE
+void mpool_tag( void *p, const void *p_tag )
+{
+	mblk_t *p_mblk;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p
+	 */
+	UTIL_ASSERT( p != NULL );
+
+	p_mblk = (mblk_t*)( (os_byte_t*)p - MBLK_HEADER_SIZE );
+
+	/*
+	 * If failed:
+	 * Block not allocated
+	 */
+	UTIL_ASSERT( !MBLK_IS_FREE(p_mblk) );
+
+	p_mblk->p_tag = p_tag;
+}
+#endif
+
+/*
+ * Check the integrity of one memory block
+ */
+UTIL_UNSAFE
+static bool_t mpool_check_block( const mpool_t *p_mpool, const mblk_t *p_mblk )
+{
+	const mblk_t *p_neighbour;
+
+	/* header */
+	if( !MPOOL_IS_ALIGNED(p_mblk) )
+		return false;
+
+#if OSPORT_MEM_GUARD
+	if( p_mblk->guard != MBLK_GUARD(p_mblk) )
+		return false;
+#endif
+
+	/* size */
+	if( !MPOOL_IS_ALIGNED(p_mblk->size) || (p_mblk->size < MBLK_SMALLEST_SIZE) )
+		return false;
+
+	if( p_mblk->size > (uint_t)((os_byte_t*)p_mpool->p_end - (os_byte_t*)p_mblk) )
+		return false;
+
+#if OSPORT_MEM_COMPACT
+	/* owner index */
+	if( !MBLK_IS_FREE(p_mblk) && ((p_mblk->owner > OSPORT_MEM_NUM_OWNERS) ||
+			(mlst_owners[p_mblk->owner - 1] == NULL)) )
+		return false;
+#endif
+
+	/* links, both lists are circular */
+	if( MBLK_HAS_LINKS(p_mblk) )
+	{
+		if( !MPOOL_CONTAINS(p_mpool, p_mblk->p_next) ||
+				!MPOOL_CONTAINS(p_mpool, p_mblk->p_prev) ||
+				!MPOOL_IS_ALIGNED(p_mblk->p_next) ||
+				!MPOOL_IS_ALIGNED(p_mblk->p_prev) )
+			return false;
+
+		if( (p_mblk->p_next->p_prev != p_mblk) || (p_mblk->p_prev->p_next != p_mblk) )
+			return false;
+	}
+
+	if( MBLK_IS_FREE(p_mblk) )
+	{
+		/* address order, only the last block links back to a lower address */
+		if( (p_mblk->p_next <= p_mblk) && (p_mblk->p_next != p_mpool->p_head) )
+			return false;
+
+		/* free neighbours must have been merged */
+		p_neighbour = (const mblk_t*)( (const os_byte_t*)p_mblk + p_mblk->size );
+
+		if( MPOOL_CONTAINS(p_mpool, p_neighbour) && (p_neighbour == p_mblk->p_next) )
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Check the integrity of the pool incrementally, at most count blocks
+ * are checked in address order, continuing from the previous call.
+ * Returns the first corrupted block found, or NULL.
+ */
+UTIL_UNSAFE
+mblk_t *mpool_check( mpool_t *p_mpool, uint_t count )
+{
+	mblk_t *p_i;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mpool
+	 */
+	UTIL_ASSERT( p_mpool != NULL );
+
+	/* stop at first corrupted block */
+	if( p_mpool->p_corrupt != NULL )
+		return p_mpool->p_corrupt;
+
+	/* pool not initialized */
+	if( p_mpool->p_start == NULL )
+		return NULL;
+
+	p_i = p_mpool->p_check;
+
+	if( p_i == NULL )
+		p_i = (mblk_t*)p_mpool->p_start;
+
+	while( count > 0 )
+	{
+		if( !mpool_check_block(p_mpool, p_i) )
+		{
+			p_mpool->p_corrupt = p_i;
+			break;
+		}
+
+		p_i = (mblk_t*)( (os_byte_t*)p_i + p_i->size );
+
+		/* start over */
+		if( (os_byte_t*)p_i >= (os_byte_t*)p_mpool->p_end )
+			p_i = (mblk_t*)p_mpool->p_start;
+
+		count--;
+	}
+
+	p_mpool->p_check = p_i;
+
+	return p_mpool->p_corrupt;
+}
+
+/*
+ * Gather memory block information
+ */
+UTIL_UNSAFE
+void mblk_gather_info( const mblk_t *p_mblk, mblk_info_t *p_info)
+{
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_mblk != NULL );
+	UTIL_ASSERT( p_info != NULL );
+
+	p_info->size = p_mblk->size;
+
+#if OSPORT_MEM_TRACE
+	p_info->p_tag = p_mblk->p_tag;
+	p_info->timestamp = p_mblk->timestamp;
+#else
+	p_info->p_tag = NULL;
+	p_info->timestamp = 0;
+#endif
+}
+
+/*
+ * Gather memory list information
+ */
+UTIL_UNSAFE
+void mlst_gather_info( const mlst_t *p_mlst, mlst_info_t *p_info)
+{
+#if OSPORT_MEM_COMPACT
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_mlst != NULL );
+	UTIL_ASSERT( p_info != NULL );
+
+	p_info->count = p_mlst->count;
+	p_info->size = p_mlst->size;
+#else
+	mblk_t *p_i;
+	uint_t count = 0, size = 0;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_mlst != NULL );
+	UTIL_ASSERT( p_info != NULL );
+
+	if( p_mlst->p_head != NULL )
+	{
 		p_i = p_mlst->p_head;
 
 		do {
@@ -596,6 +1581,7 @@ void mlst_gather_info( const mlst_t *p_mlst, mlst_info_t *p_info)
 
 	p_info->count = count;
 	p_info->size = size;
+#endif
 }
 
 /*
@@ -605,7 +1591,8 @@ UTIL_UNSAFE
 void mpool_gather_info( const mpool_t *p_mpool, mpool_info_t *p_info)
 {
 	mblk_t *p_i;
-	uint_t count = 0, size = 0;
+	uint_t count = 0, size = 0, largest = 0;
+	uint_t limit, sclass;
 
 	/*
 	 * If failed:
@@ -614,6 +1601,9 @@ void mpool_gather_info( const mpool_t *p_mpool, mpool_info_t *p_info)
 	UTIL_ASSERT( p_mpool != NULL );
 	UTIL_ASSERT( p_info != NULL );
 
+	for( sclass = 0; sclass < OSPORT_MEM_NUM_SIZE_CLASSES; sclass++ )
+		p_info->histogram[sclass] = 0;
+
 	if( p_mpool->p_head != NULL )
 	{
 		/*
@@ -628,6 +1618,25 @@ void mpool_gather_info( const mpool_t *p_mpool, mpool_info_t *p_info)
 			size += p_i->size;
 			count++;
 
+			if( p_i->size > largest )
+				largest = p_i->size;
+
+			/*
+			 * size class n holds blocks smaller than
+			 * the smallest block size times 2^(n+1),
+			 * the last size class holds all larger blocks
+			 */
+			limit = MBLK_SMALLEST_SIZE << 1;
+			for( sclass = 0; sclass < OSPORT_MEM_NUM_SIZE_CLASSES - 1; sclass++ )
+			{
+				if( p_i->size < limit )
+					break;
+
+				limit <<= 1;
+			}
+
+			p_info->histogram[sclass]++;
+
 			p_i = p_i->p_next;
 
 			/*
@@ -641,10 +1650,58 @@ void mpool_gather_info( const mpool_t *p_mpool, mpool_info_t *p_info)
 
 	p_info->count = count;
 	p_info->size = size;
+	p_info->largest = largest;
+}
+
+/*
+ * Walk the pool memory in address order, returns the allocated
+ * block following p_mblk, or the first allocated block when p_mblk
+ * is NULL. Returns NULL when no more allocated blocks exist.
+ */
+UTIL_UNSAFE
+mblk_t *mpool_next_used( const mpool_t *p_mpool, const mblk_t *p_mblk )
+{
+	mblk_t *p_i;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_mpool
+	 */
+	UTIL_ASSERT( p_mpool != NULL );
+
+	if( p_mblk == NULL )
+		p_i = (mblk_t*)p_mpool->p_start;
+	else
+		p_i = (mblk_t*)( (os_byte_t*)p_mblk + p_mblk->size );
+
+	while( (os_byte_t*)p_i < (os_byte_t*)p_mpool->p_end )
+	{
+		/*
+		 * If failed:
+		 * Corrupted block size
+		 */
+		UTIL_ASSERT( p_i->size != 0 );
+		UTIL_ASSERT( MPOOL_IS_ALIGNED(p_i->size) );
+
+		if( !MBLK_IS_FREE(p_i) )
+			return p_i;
+
+		p_i = (mblk_t*)( (os_byte_t*)p_i + p_i->size );
+	}
+
+	return NULL;
 }
 
 #include "../include/api.h"
 
+/*
+ * Memory pressure callbacks, run by a thread created when
+ * the first callback is registered
+ */
+static os_memory_pressure_cb_t mpool_pressure_cbs[OSPORT_MEM_PRESSURE_NUM_CBS];
+static volatile uint_t mpool_pressure_num_cbs = 0;
+static sem_cblk_t mpool_pressure_sem;
+
 /**
  * @brief Allocates a continuous memory block to the calling thread
  * @param size the requested size of the continuous memory block
@@ -676,15 +1733,81 @@ void mpool_gather_info( const mpool_t *p_mpool, mpool_info_t *p_info)
  * cannot be accessed again and cannot be freed again. The memory allocated
  * by one thread can be freed by another thread or even interrupts. Upon
  * thread deletion, the unfreed memory will be automatically recycled.
+ *
+ * The pool is searched with interrupts enabled and preemption disabled.
+ * Interrupts are only masked for a few instructions to take and release
+ * the pool lock.
  */
 UTIL_SAFE
 void *os_memory_allocate( os_uint_t size )
 {
 	void *p_ret;
 
-	UTIL_LOCK_EVERYTHING();
-	p_ret = mpool_alloc( size, &g_mpool, &g_sch.p_current->mlst);
-	UTIL_UNLOCK_EVERYTHING();
+	p_ret = mpool_lock_alloc( size, &g_mpool, &g_sch.p_current->mlst, MPOOL_TRANSIENT, &g_sch );
+
+	if( p_ret != NULL )
+		MPOOL_TAG( p_ret, OSPORT_CALLER_ADDRESS() );
+
+	return p_ret;
+}
+
+/**
+ * @brief Allocates a continuous memory block tagged with a call site
+ * @param size the requested size of the continuous memory block
+ * @param p_tag a value identifying the call site, usually the address
+ * of a string or a function
+ * @retval !NULL allocation successful
+ * @retval NULL allocation failed because of low memory
+ * @details Same as @ref os_memory_allocate, but the allocated block is
+ * reported under p_tag by @ref os_memory_get_trace. The tag is discarded
+ * when OSPORT_MEM_TRACE is not enabled.
+ * @note This function can only be called in a thread context.
+ */
+UTIL_SAFE
+void *os_memory_allocate_tagged( os_uint_t size, const void *p_tag )
+{
+	void *p_ret;
+
+	p_ret = mpool_lock_alloc( size, &g_mpool, &g_sch.p_current->mlst, MPOOL_TRANSIENT, &g_sch );
+
+	if( p_ret != NULL )
+		MPOOL_TAG( p_ret, p_tag );
+
+	(void)p_tag; /* unused without OSPORT_MEM_TRACE */
+	return p_ret;
+}
+
+/**
+ * @brief Allocates a continuous memory block with a placement hint
+ * @param size the requested size of the continuous memory block
+ * @param hint OS_MEMORY_LONG_LIVED for memory kept for the lifetime of
+ * the application or of a long running thread, OS_MEMORY_TRANSIENT
+ * otherwise
+ * @retval !NULL allocation successful
+ * @retval NULL allocation failed because of low memory
+ * @details Same as @ref os_memory_allocate, which allocates transient
+ * memory. Long-lived memory is placed from the high end of the pool,
+ * so that it does not pin holes between transient blocks and the free
+ * memory stays continuous. Thread stacks and queue buffers are always
+ * allocated as long-lived.
+ * @note This function can only be called in a thread context.
+ */
+UTIL_SAFE
+void *os_memory_allocate_ex( os_uint_t size, os_memory_hint_t hint )
+{
+	void *p_ret;
+
+	/*
+	 * If failed:
+	 * Invalid hint
+	 */
+	UTIL_ASSERT( (hint == OS_MEMORY_TRANSIENT) || (hint == OS_MEMORY_LONG_LIVED) );
+
+	p_ret = mpool_lock_alloc( size, &g_mpool, &g_sch.p_current->mlst,
+			(hint == OS_MEMORY_LONG_LIVED)? MPOOL_LONG_LIVED : MPOOL_TRANSIENT, &g_sch );
+
+	if( p_ret != NULL )
+		MPOOL_TAG( p_ret, OSPORT_CALLER_ADDRESS() );
 
 	return p_ret;
 }
@@ -692,7 +1815,10 @@ void *os_memory_allocate( os_uint_t size )
 /*
  * @brief Frees a piece of memory
  * @param p a non-NULL pointer previously returned by @ref os_memory_allocate
- * @details This function recycles dynamic memory when it is no longer needed
+ * @details This function recycles dynamic memory when it is no longer needed.
+ * When an interrupt frees memory while the pool is in use by the code it
+ * interrupted, the memory is queued and returned to the pool as soon as
+ * the pool is released.
  * @note This function can be used in thread or interrupt context.
  */
 UTIL_SAFE
@@ -700,9 +1826,156 @@ void os_memory_free( void *p )
 {
 	UTIL_ASSERT( p != NULL );
 
+	mpool_lock_free( p, &g_mpool, &g_sch );
+}
+
+/**
+ * @brief Frees a piece of memory later
+ * @param p a non-NULL pointer previously returned by @ref os_memory_allocate
+ * @details The memory is pushed to a pending list in constant time without
+ * touching the pool, and returned to the pool by the next allocation or
+ * free, or by @ref os_memory_collect. The memory cannot be reused before
+ * that, so this function suits interrupts that release buffers often.
+ * @note This function can be used in thread or interrupt context.
+ */
+UTIL_SAFE
+void os_memory_free_deferred( void *p )
+{
+	UTIL_ASSERT( p != NULL );
+
+	mpool_defer( p, &g_mpool );
+}
+
+/**
+ * @brief Returns memory freed by @ref os_memory_free_deferred to the pool
+ * @details Does nothing if the pool is in use, the memory is then returned
+ * by the pool user. Intended to be called from OSPORT_IDLE_FUNC.
+ * @note This function can only be used in thread context.
+ */
+UTIL_SAFE
+void os_memory_collect( void )
+{
+	if( mpool_lock( &g_mpool, &g_sch ) )
+		mpool_unlock( &g_mpool, &g_sch );
+}
+
+/*
+ * Memory pressure thread, calls the callbacks every time
+ * the pressure level rises
+ */
+static void mpool_pressure_job( void )
+{
+	uint_t i, level;
+
+	for( ; ; )
+	{
+		os_semaphore_wait( (os_handle_t)&mpool_pressure_sem, 0 );
+
+		/* the level may have eased before the thread runs */
+		level = g_mpool.pressure;
+
+		if( level != MPOOL_PRESSURE_NONE )
+		{
+			for( i = 0; i < mpool_pressure_num_cbs; i++ )
+				mpool_pressure_cbs[i]( (os_memory_pressure_t)level );
+		}
+	}
+}
+
+/**
+ * @brief Sets the memory pressure watermarks
+ * @param low_size free size below which the pressure is low
+ * @param critical_size free size below which the pressure is critical,
+ * must not be larger than low_size
+ * @details The free size is compared with the watermarks on every
+ * allocation and free. A failed allocation always raises the pressure
+ * to critical. Pass 0 for both to disable pressure tracking.
+ * @note This function can be used in thread or interrupt context.
+ */
+UTIL_SAFE
+void os_memory_set_watermarks( os_uint_t low_size, os_uint_t critical_size )
+{
+	/*
+	 * If failed:
+	 * Critical watermark above low watermark
+	 */
+	UTIL_ASSERT( critical_size <= low_size );
+
+	UTIL_LOCK_EVERYTHING();
+	g_mpool.low_size = low_size;
+	g_mpool.critical_size = critical_size;
+	UTIL_UNLOCK_EVERYTHING();
+}
+
+/**
+ * @brief Returns the current memory pressure level
+ * @note This function can be used in thread or interrupt context.
+ */
+UTIL_SAFE
+os_memory_pressure_t os_memory_get_pressure( void )
+{
+	os_memory_pressure_t ret;
+
 	UTIL_LOCK_EVERYTHING();
-	mpool_free(p, &g_mpool);
+	ret = (os_memory_pressure_t)g_mpool.pressure;
 	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+/**
+ * @brief Registers a memory pressure callback
+ * @param p_cb the function called when the pressure level rises
+ * @retval true callback registered
+ * @retval false too many callbacks, or the pressure thread could not
+ * be created because of low memory
+ * @details Callbacks are called in registration order by a kernel
+ * thread of priority OSPORT_MEM_PRESSURE_PRIO, created by the first
+ * registration. They run with the pool unlocked, and are expected to
+ * free cached memory, such as free lists, log buffers or pools, before
+ * allocations start failing.
+ * @note This function can only be used in thread context.
+ */
+UTIL_SAFE
+os_bool_t os_memory_register_pressure_cb( os_memory_pressure_cb_t p_cb )
+{
+	os_handle_t h_thd = 1;
+	bool_t ret = false;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_cb
+	 */
+	UTIL_ASSERT( p_cb != NULL );
+
+	/* registrations do not interleave, the thread is created once */
+	sch_lock_preempt( &g_sch );
+
+	if( g_mpool.p_pressure_sem == NULL )
+	{
+		sem_init( &mpool_pressure_sem, 0 );
+
+		h_thd = os_thread_create( OSPORT_MEM_PRESSURE_PRIO,
+				OSPORT_MEM_PRESSURE_STACK_SIZE, mpool_pressure_job );
+
+		if( h_thd != 0 )
+		{
+			UTIL_LOCK_EVERYTHING();
+			g_mpool.p_pressure_sem = &mpool_pressure_sem;
+			UTIL_UNLOCK_EVERYTHING();
+		}
+	}
+
+	if( (h_thd != 0) && (mpool_pressure_num_cbs < OSPORT_MEM_PRESSURE_NUM_CBS) )
+	{
+		mpool_pressure_cbs[mpool_pressure_num_cbs] = p_cb;
+		mpool_pressure_num_cbs++;
+		ret = true;
+	}
+
+	sch_unlock_preempt( &g_sch );
+
+	return ret;
 }
 
 /**
@@ -734,11 +2007,21 @@ void os_memory_get_block_info( void *p, os_memory_block_info_t *p_info )
 /**
  * @brief Obtain memory allocation details of system pool
  * @param p_info a pointer to a struct where obtained info should be stored
+ * @details The counters are maintained on every allocation and free, the
+ * largest block, the size class histogram and the fragmentation index are
+ * obtained by walking the free blocks of the pool.
+ *
+ * The fragmentation index ranges from 0 to 100. 0 means that all free
+ * memory is available as one continuous block, and values approaching 100
+ * mean that the free memory is scattered over many small blocks.
+ * @note This function can only be called in a thread context.
  */
 UTIL_SAFE
 void os_memory_get_pool_info( os_memory_pool_info_t *p_info )
 {
 	mpool_info_t info;
+	uint_t counter;
+	bool_t locked;
 
 	/*
 	 * If failed:
@@ -746,23 +2029,61 @@ void os_memory_get_pool_info( os_memory_pool_info_t *p_info )
 	 */
 	UTIL_ASSERT( p_info != NULL );
 
-	UTIL_LOCK_EVERYTHING();
-	mpool_gather_info( &g_mpool, &info );
-	p_info->num_blocks = info.count;
-	p_info->pool_size = info.size;
-	UTIL_UNLOCK_EVERYTHING();
+	locked = mpool_lock( &g_mpool, &g_sch );
+
+	/*
+	 * If failed:
+	 * Pool in use, called from an interrupt
+	 */
+	UTIL_ASSERT( locked );
+
+	if( locked )
+	{
+		mpool_gather_info( &g_mpool, &info );
+		p_info->num_blocks = info.count;
+		p_info->pool_size = info.size;
+		p_info->total_size = g_mpool.total_size;
+		p_info->min_free_size = g_mpool.min_free_size;
+		p_info->peak_used_size = g_mpool.total_size - g_mpool.min_free_size;
+		p_info->num_allocs = g_mpool.num_allocs;
+		p_info->num_frees = g_mpool.num_frees;
+		p_info->num_failures = g_mpool.num_failures;
+		p_info->max_scan_length = g_mpool.max_scan;
+		mpool_unlock( &g_mpool, &g_sch );
+
+		for( counter = 0; counter < OSPORT_MEM_NUM_SIZE_CLASSES; counter++ )
+			p_info->free_histogram[counter] = info.histogram[counter];
+
+		if( info.largest > MBLK_HEADER_SIZE )
+			p_info->max_alloc_size = info.largest - MBLK_HEADER_SIZE;
+		else
+			p_info->max_alloc_size = 0;
+
+		/* 100 * (1 - largest / size), without overflowing small integers */
+		if( info.size == 0 )
+			p_info->fragmentation = 0;
+		else if( info.size < 100 )
+			p_info->fragmentation = (info.size - info.largest) * 100 / info.size;
+		else
+			p_info->fragmentation = (info.size - info.largest) / (info.size / 100);
+
+		if( p_info->fragmentation > 100 )
+			p_info->fragmentation = 100;
+	}
 }
 
 /**
  * @brief Obtain memory allocation details of a thread
  * @param h_thread handle to a thread. Pass 0 for current thread
  * @param p_info a pointer to a struct where obtained info should be stored
+ * @note This function can only be called in a thread context.
  */
 UTIL_SAFE
 void os_memory_get_thread_info( os_handle_t h_thread, os_memory_thread_info_t *p_info )
 {
 	thd_cblk_t *p_thd;
 	mlst_info_t info;
+	bool_t locked;
 
 	/*
 	 * If failed:
@@ -775,10 +2096,142 @@ void os_memory_get_thread_info( os_handle_t h_thread, os_memory_thread_info_t *p
 	else
 		p_thd = (thd_cblk_t*)h_thread;
 
-	UTIL_LOCK_EVERYTHING();
-	mlst_gather_info( &p_thd->mlst, &info );
-	p_info->num_blocks = info.count;
-	p_info->thread_size = info.size;
-	UTIL_UNLOCK_EVERYTHING();
+	locked = mpool_lock( &g_mpool, &g_sch );
+
+	/*
+	 * If failed:
+	 * Pool in use, called from an interrupt
+	 */
+	UTIL_ASSERT( locked );
+
+	if( locked )
+	{
+		mlst_gather_info( &p_thd->mlst, &info );
+		p_info->num_blocks = info.count;
+		p_info->thread_size = info.size;
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+}
+
+/**
+ * @brief Obtain the memory held by each call site
+ * @param p_entries a table where the call sites should be stored
+ * @param max number of entries in the table
+ * @return number of call sites stored in the table
+ * @details Walks every allocated block in the system pool, including the
+ * blocks held by the kernel and by every thread, and sums up the live
+ * memory for each call site tag. Blocks are tagged with the return address
+ * of @ref os_memory_allocate (as obtained by OSPORT_CALLER_ADDRESS) or with
+ * the tag passed to @ref os_memory_allocate_tagged. When there are more
+ * call sites than entries in the table, the excess call sites are not
+ * reported.
+ *
+ * Call sites and ages are only recorded when OSPORT_MEM_TRACE is enabled,
+ * otherwise all allocated memory is reported as a single NULL call site.
+ * @note This function walks the whole pool and should only be used for
+ * debugging. It can only be called in a thread context.
+ */
+UTIL_SAFE
+os_uint_t os_memory_get_trace( os_memory_trace_t *p_entries, os_uint_t max )
+{
+	mblk_t *p_mblk;
+	mblk_info_t info;
+	uint_t counter, count = 0, age;
+	bool_t locked;
+
+	/*
+	 * If failed:
+	 * Invalid parameter
+	 */
+	UTIL_ASSERT( (p_entries != NULL) || (max == 0) );
+
+	locked = mpool_lock( &g_mpool, &g_sch );
+
+	/*
+	 * If failed:
+	 * Pool in use, called from an interrupt
+	 */
+	UTIL_ASSERT( locked );
+
+	if( locked )
+	{
+		p_mblk = mpool_next_used( &g_mpool, NULL );
+
+		while( p_mblk != NULL )
+		{
+			mblk_gather_info( p_mblk, &info );
+
+#if OSPORT_MEM_TRACE
+			age = g_sch.timestamp - info.timestamp;
+#else
+			age = 0;
+#endif
+
+			/* find existing entry */
+			for( counter = 0; counter < count; counter++ )
+			{
+				if( p_entries[counter].p_tag == info.p_tag )
+					break;
+			}
+
+			/* new call site, ignored if table full */
+			if( (counter == count) && (count < max) )
+			{
+				p_entries[counter].p_tag = info.p_tag;
+				p_entries[counter].live_size = 0;
+				p_entries[counter].num_blocks = 0;
+				p_entries[counter].max_age = 0;
+				count++;
+			}
+
+			if( counter < count )
+			{
+				p_entries[counter].live_size += info.size;
+				p_entries[counter].num_blocks++;
+
+				if( age > p_entries[counter].max_age )
+					p_entries[counter].max_age = age;
+			}
+
+			p_mblk = mpool_next_used( &g_mpool, p_mblk );
+		}
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	return count;
 }
 
+/**
+ * @brief Check the integrity of the system pool incrementally
+ * @retval NULL no corruption found so far
+ * @retval !NULL address of the header of the first corrupted block
+ * @details Each call checks OSPORT_MEM_CHECK_STEP blocks in address order,
+ * continuing where the previous call stopped and starting over at the end
+ * of the pool. The header guard word (with OSPORT_MEM_GUARD), alignment,
+ * size, list links, address order of free blocks, and merging of free
+ * neighbours are verified. Once a corrupted block has been found, it is
+ * reported by every subsequent call.
+ *
+ * The time spent with the pool locked is bounded by OSPORT_MEM_CHECK_STEP,
+ * so this function is intended to be called repeatedly from the idle
+ * function. When called from an interrupt that finds the pool in use, no
+ * blocks are checked.
+ * @note This function is thread safe and can be used in a thread or
+ * interrupt context.
+ */
+UTIL_SAFE
+const void *os_memory_check_step( void )
+{
+	const void *p_ret;
+
+	if( mpool_lock( &g_mpool, &g_sch ) )
+	{
+		p_ret = mpool_check( &g_mpool, OSPORT_MEM_CHECK_STEP );
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+	else
+		p_ret = g_mpool.p_corrupt;
+
+	return p_ret;
+}
@@ -0,0 +1,731 @@
+/** ************************************************************************
+ * @file msgq.c
+ * @brief Fixed-size message queue
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#include "../include/msgq.h"
+#include "../include/global.h"
+#include "../include/api.h"
+
+/*
+ * Initialize message queue
+ */
+UTIL_UNSAFE
+void msgq_init( msgq_cblk_t *p_msgq, void *p_buffer, uint_t item_size, uint_t item_count )
+{
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+	UTIL_ASSERT( item_size != 0 );
+	UTIL_ASSERT( item_count != 0 );
+
+	p_msgq->p_buffer = (byte_t*)p_buffer;
+	p_msgq->item_size = item_size;
+	p_msgq->item_count = item_count;
+	p_msgq->read = 0;
+	p_msgq->count = 0;
+
+	/* slot indices wrap with a mask when possible */
+	if( (item_count & (item_count - 1)) == 0 )
+		p_msgq->mask = item_count - 1;
+	else
+		p_msgq->mask = 0;
+
+	sch_q_init( &p_msgq->q_wait_read );
+	sch_q_init( &p_msgq->q_wait_write );
+}
+
+/*
+ * Ready all threads waiting on a message queue of any kind
+ */
+UTIL_UNSAFE
+void msgq_ready_all( sch_qprio_t *p_wait_read, sch_qprio_t *p_wait_write, sch_cblk_t *p_sch )
+{
+	sch_qitem_t *p_item;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_wait_read != NULL );
+	UTIL_ASSERT( p_wait_write != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	/* ready all reading threads */
+	while( p_wait_read->p_head != NULL )
+	{
+		p_item = p_wait_read->p_head;
+
+		/*
+		 * If failed:
+		 * cannot obtain thread from item
+		 */
+		UTIL_ASSERT( p_item->p_thd != NULL );
+
+		thd_ready( p_item->p_thd, p_sch );
+	}
+
+	/* ready all writing threads */
+	while( p_wait_write->p_head != NULL )
+	{
+		p_item = p_wait_write->p_head;
+
+		/*
+		 * If failed:
+		 * cannot obtain thread from item
+		 */
+		UTIL_ASSERT( p_item->p_thd != NULL );
+
+		thd_ready( p_item->p_thd, p_sch );
+	}
+
+	sch_reschedule_req(p_sch);
+}
+
+/*
+ * Delete a static message queue
+ */
+UTIL_UNSAFE
+void msgq_delete_static( msgq_cblk_t *p_msgq, sch_cblk_t *p_sch )
+{
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_msgq or p_sch
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	msgq_ready_all( &p_msgq->q_wait_read, &p_msgq->q_wait_write, p_sch );
+}
+
+/*
+ * Wrap a slot index below twice the number of slots
+ */
+UTIL_UNSAFE
+static uint_t msgq_wrap( const msgq_cblk_t *p_msgq, uint_t index )
+{
+	uint_t ret;
+
+	if( p_msgq->mask != 0 )
+		ret = index & p_msgq->mask;
+	else if( index >= p_msgq->item_count )
+		ret = index - p_msgq->item_count;
+	else
+		ret = index;
+
+	return ret;
+}
+
+/*
+ * Write an item after the last one
+ */
+UTIL_UNSAFE
+void msgq_write( msgq_cblk_t *p_msgq, const byte_t *p_data )
+{
+	uint_t write;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+	UTIL_ASSERT( p_data != NULL );
+
+	/*
+	 * If failed:
+	 * Invalid buffer or queue full
+	 */
+	UTIL_ASSERT( p_msgq->p_buffer != NULL );
+	UTIL_ASSERT( p_msgq->count < p_msgq->item_count );
+
+	write = msgq_wrap( p_msgq, p_msgq->read + p_msgq->count );
+	util_copy( p_msgq->p_buffer + write * p_msgq->item_size, p_data, p_msgq->item_size );
+	p_msgq->count++;
+}
+
+/*
+ * Write an item before the first one
+ */
+UTIL_UNSAFE
+void msgq_write_ahead( msgq_cblk_t *p_msgq, const byte_t *p_data )
+{
+	uint_t read;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+	UTIL_ASSERT( p_data != NULL );
+
+	/*
+	 * If failed:
+	 * Invalid buffer or queue full
+	 */
+	UTIL_ASSERT( p_msgq->p_buffer != NULL );
+	UTIL_ASSERT( p_msgq->count < p_msgq->item_count );
+
+	read = msgq_wrap( p_msgq, p_msgq->read + p_msgq->item_count - 1 );
+	util_copy( p_msgq->p_buffer + read * p_msgq->item_size, p_data, p_msgq->item_size );
+	p_msgq->read = read;
+	p_msgq->count++;
+}
+
+/*
+ * Copy the first item
+ */
+UTIL_UNSAFE
+void msgq_peek( const msgq_cblk_t *p_msgq, byte_t *p_data )
+{
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+	UTIL_ASSERT( p_data != NULL );
+
+	/*
+	 * If failed:
+	 * Invalid buffer or queue empty
+	 */
+	UTIL_ASSERT( p_msgq->p_buffer != NULL );
+	UTIL_ASSERT( p_msgq->count != 0 );
+
+	util_copy( p_data, p_msgq->p_buffer + p_msgq->read * p_msgq->item_size, p_msgq->item_size );
+}
+
+/*
+ * Remove the first item
+ */
+UTIL_UNSAFE
+void msgq_read( msgq_cblk_t *p_msgq, byte_t *p_data )
+{
+	msgq_peek( p_msgq, p_data );
+
+	p_msgq->read = msgq_wrap( p_msgq, p_msgq->read + 1 );
+	p_msgq->count--;
+}
+
+/*
+ * Unblock threads of a message queue of any kind as long as
+ * items or slots are available, p_count is the number of items
+ */
+UTIL_UNSAFE
+void msgq_serve_threads( sch_qprio_t *p_wait_read, sch_qprio_t *p_wait_write, void *p_obj,
+		const volatile uint_t *p_count, uint_t item_count, const msgq_ops_t *p_ops, sch_cblk_t *p_sch )
+{
+	bool_t can_read = true, can_write = true;
+	thd_cblk_t *p_thd;
+	queue_schinfo_read_t *p_readinfo;
+	queue_schinfo_write_t *p_writeinfo;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_wait_read != NULL );
+	UTIL_ASSERT( p_wait_write != NULL );
+	UTIL_ASSERT( p_count != NULL );
+	UTIL_ASSERT( p_ops != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	while( can_read || can_write )
+	{
+		if( can_write )
+		{
+			/* has writing threads and free slots */
+			if( (p_wait_write->p_head != NULL) && (*p_count < item_count) )
+			{
+				/*
+				 * If failed:
+				 * cannot obtain thread
+				 */
+				UTIL_ASSERT( p_wait_write->p_head->p_thd != NULL );
+				p_thd = p_wait_write->p_head->p_thd;
+
+				/*
+				 * If failed:
+				 * write info missing
+				 */
+				UTIL_ASSERT( p_wait_write->p_head->p_schinfo != NULL );
+				p_writeinfo = p_wait_write->p_head->p_schinfo;
+
+				p_ops->p_write( p_obj, p_writeinfo );
+
+				can_read = true;
+				p_writeinfo->result = true;
+				thd_ready( p_thd, p_sch );
+			}
+			else
+				can_write = false;
+		}
+
+		if( can_read )
+		{
+			/* has reading threads and items */
+			if( (p_wait_read->p_head != NULL) && (*p_count != 0) )
+			{
+				/*
+				 * If failed:
+				 * cannot obtain thread
+				 */
+				UTIL_ASSERT( p_wait_read->p_head->p_thd != NULL );
+				p_thd = p_wait_read->p_head->p_thd;
+
+				/*
+				 * If failed:
+				 * read info missing
+				 */
+				UTIL_ASSERT( p_wait_read->p_head->p_schinfo != NULL );
+				p_readinfo = p_wait_read->p_head->p_schinfo;
+
+				if( p_ops->p_read( p_obj, p_readinfo ) )
+					can_write = true;
+
+				p_readinfo->result = true;
+				thd_ready( p_thd, p_sch );
+			}
+			else
+				can_read = false;
+		}
+	}
+
+	sch_reschedule_req( p_sch );
+}
+
+/*
+ * Store the item of a waiting writer
+ */
+UTIL_UNSAFE
+static void msgq_serve_write( void *p_obj, const queue_schinfo_write_t *p_writeinfo )
+{
+	if( p_writeinfo->flag & QUEUE_WRITE_AHEAD )
+		msgq_write_ahead( (msgq_cblk_t*)p_obj, p_writeinfo->p_data );
+	else
+		msgq_write( (msgq_cblk_t*)p_obj, p_writeinfo->p_data );
+}
+
+/*
+ * Serve a waiting reader, peeking leaves the item in place
+ */
+UTIL_UNSAFE
+static bool_t msgq_serve_read( void *p_obj, const queue_schinfo_read_t *p_readinfo )
+{
+	bool_t ret = false;
+
+	if( p_readinfo->flag & QUEUE_READ_PEEK )
+	{
+		if( p_readinfo->p_data != NULL )
+			msgq_peek( (msgq_cblk_t*)p_obj, p_readinfo->p_data );
+	}
+	else
+	{
+		msgq_read( (msgq_cblk_t*)p_obj, p_readinfo->p_data );
+		ret = true;
+	}
+
+	return ret;
+}
+
+/*
+ * Unblock threads as long as items or slots are available
+ */
+UTIL_UNSAFE
+void msgq_unlock_threads( msgq_cblk_t *p_msgq, sch_cblk_t *p_sch )
+{
+	static const msgq_ops_t ops = { msgq_serve_write, msgq_serve_read };
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_msgq or p_sch
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	msgq_serve_threads( &p_msgq->q_wait_read, &p_msgq->q_wait_write, p_msgq,
+			&p_msgq->count, p_msgq->item_count, &ops, p_sch );
+}
+
+UTIL_SAFE
+os_handle_t os_msgq_create( os_uint_t item_size, os_uint_t item_count )
+{
+	msgq_cblk_t *p_msgq = NULL;
+	byte_t *p_buffer = NULL;
+
+	/*
+	 * If failed:
+	 * Invalid item size or count
+	 */
+	UTIL_ASSERT( item_size != 0 );
+	UTIL_ASSERT( item_count != 0 );
+
+	/* written to avoid overflowing on large requests */
+	if( (item_count <= MPOOL_SIZE_MAX / item_size) && mpool_lock( &g_mpool, &g_sch ) )
+	{
+		p_msgq = mpool_alloc( sizeof(msgq_cblk_t), &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+		if( p_msgq != NULL )
+		{
+			p_buffer = mpool_alloc( item_size * item_count, &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+			if( p_buffer == NULL )
+			{
+				mpool_free( p_msgq, &g_mpool );
+				p_msgq = NULL;
+			}
+			else
+			{
+				MPOOL_TAG( p_msgq, OSPORT_CALLER_ADDRESS() );
+				MPOOL_TAG( p_buffer, OSPORT_CALLER_ADDRESS() );
+			}
+		}
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	if( p_msgq != NULL )
+	{
+		UTIL_LOCK_EVERYTHING();
+		msgq_init( p_msgq, p_buffer, item_size, item_count );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return (os_handle_t)p_msgq;
+}
+
+UTIL_SAFE
+void os_msgq_delete( os_handle_t h_msgq )
+{
+	msgq_cblk_t *p_msgq;
+	p_msgq = (msgq_cblk_t*)h_msgq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_msgq
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	msgq_delete_static( p_msgq, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+
+	/* free memory */
+	mpool_lock_free( p_msgq->p_buffer, &g_mpool, &g_sch );
+	mpool_lock_free( p_msgq, &g_mpool, &g_sch );
+}
+
+UTIL_SAFE
+void os_msgq_reset( os_handle_t h_msgq )
+{
+	msgq_cblk_t *p_msgq;
+	p_msgq = (msgq_cblk_t*)h_msgq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_msgq
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	p_msgq->read = 0;
+	p_msgq->count = 0;
+	msgq_unlock_threads( p_msgq, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+}
+
+UTIL_SAFE
+os_uint_t os_msgq_get_count( os_handle_t h_msgq )
+{
+	msgq_cblk_t *p_msgq;
+	uint_t ret;
+	p_msgq = (msgq_cblk_t*)h_msgq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_msgq
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	ret = p_msgq->count;
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+/*
+ * Send an item, at the end or ahead of the others
+ */
+UTIL_SAFE
+static os_bool_t msgq_send( msgq_cblk_t *p_msgq, const void *p_data, uint_t flag,
+		bool_t block, os_uint_t timeout )
+{
+	os_bool_t ret = false;
+	queue_schinfo_write_t schinfo;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_msgq or p_data
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+	UTIL_ASSERT( p_data != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	if( p_msgq->count < p_msgq->item_count )
+	{
+		if( flag & QUEUE_WRITE_AHEAD )
+			msgq_write_ahead( p_msgq, p_data );
+		else
+			msgq_write( p_msgq, p_data );
+
+		msgq_unlock_threads( p_msgq, &g_sch );
+		ret = true;
+	}
+	else if( block )
+	{
+		queue_schnifo_write_init( &schinfo, flag );
+		schinfo.p_data = p_data;
+		schinfo.size = p_msgq->item_size;
+		thd_block_current( &p_msgq->q_wait_write, &schinfo, timeout, &g_sch );
+		ret = schinfo.result;
+	}
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+/*
+ * Receive or peek the first item
+ */
+UTIL_SAFE
+static os_bool_t msgq_receive( msgq_cblk_t *p_msgq, void *p_data, uint_t flag,
+		bool_t block, os_uint_t timeout )
+{
+	os_bool_t ret = false;
+	queue_schinfo_read_t schinfo;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_msgq, or no buffer to receive into
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+	UTIL_ASSERT( (p_data != NULL) || (flag & QUEUE_READ_PEEK) );
+
+	UTIL_LOCK_EVERYTHING();
+	if( p_msgq->count != 0 )
+	{
+		if( !(flag & QUEUE_READ_PEEK) )
+		{
+			msgq_read( p_msgq, p_data );
+			msgq_unlock_threads( p_msgq, &g_sch );
+		}
+		else if( p_data != NULL )
+			msgq_peek( p_msgq, p_data );
+
+		ret = true;
+	}
+	else if( block )
+	{
+		queue_schinfo_read_init( &schinfo, flag );
+		schinfo.p_data = p_data;
+		schinfo.size = p_msgq->item_size;
+		thd_block_current( &p_msgq->q_wait_read, &schinfo, timeout, &g_sch );
+		ret = schinfo.result;
+	}
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+UTIL_SAFE
+os_bool_t os_msgq_send( os_handle_t h_msgq, const void *p_data, os_uint_t timeout )
+{
+	return msgq_send( (msgq_cblk_t*)h_msgq, p_data, 0, true, timeout );
+}
+
+UTIL_SAFE
+os_bool_t os_msgq_send_nb( os_handle_t h_msgq, const void *p_data )
+{
+	return msgq_send( (msgq_cblk_t*)h_msgq, p_data, 0, false, 0 );
+}
+
+UTIL_SAFE
+os_bool_t os_msgq_send_ahead( os_handle_t h_msgq, const void *p_data, os_uint_t timeout )
+{
+	return msgq_send( (msgq_cblk_t*)h_msgq, p_data, QUEUE_WRITE_AHEAD, true, timeout );
+}
+
+UTIL_SAFE
+os_bool_t os_msgq_send_ahead_nb( os_handle_t h_msgq, const void *p_data )
+{
+	return msgq_send( (msgq_cblk_t*)h_msgq, p_data, QUEUE_WRITE_AHEAD, false, 0 );
+}
+
+UTIL_SAFE
+os_bool_t os_msgq_receive( os_handle_t h_msgq, void *p_data, os_uint_t timeout )
+{
+	return msgq_receive( (msgq_cblk_t*)h_msgq, p_data, 0, true, timeout );
+}
+
+UTIL_SAFE
+os_bool_t os_msgq_receive_nb( os_handle_t h_msgq, void *p_data )
+{
+	return msgq_receive( (msgq_cblk_t*)h_msgq, p_data, 0, false, 0 );
+}
+
+UTIL_SAFE
+os_bool_t os_msgq_peek( os_handle_t h_msgq, void *p_data, os_uint_t timeout )
+{
+	return msgq_receive( (msgq_cblk_t*)h_msgq, p_data, QUEUE_READ_PEEK, true, timeout );
+}
+
+UTIL_SAFE
+os_bool_t os_msgq_peek_nb( os_handle_t h_msgq, void *p_data )
+{
+	return msgq_receive( (msgq_cblk_t*)h_msgq, p_data, QUEUE_READ_PEEK, false, 0 );
+}
+
+/*
+ * Mailbox, a message queue of pointers to pool memory. Blocks in the
+ * mailbox belong to the kernel memory list, and move to the memory list
+ * of the receiving thread without being copied.
+ */
+UTIL_SAFE
+os_handle_t os_mailbox_create( os_uint_t count )
+{
+	return os_msgq_create( sizeof(void*), count );
+}
+
+UTIL_SAFE
+void os_mailbox_delete( os_handle_t h_mailbox )
+{
+	msgq_cblk_t *p_msgq;
+	void *p_block;
+	p_msgq = (msgq_cblk_t*)h_mailbox;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_msgq
+	 */
+	UTIL_ASSERT( p_msgq != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	msgq_delete_static( p_msgq, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+
+	/* blocks nobody received are freed with the mailbox */
+	while( p_msgq->count != 0 )
+	{
+		msgq_read( p_msgq, (byte_t*)&p_block );
+		mpool_lock_free( p_block, &g_mpool, &g_sch );
+	}
+
+	mpool_lock_free( p_msgq->p_buffer, &g_mpool, &g_sch );
+	mpool_lock_free( p_msgq, &g_mpool, &g_sch );
+}
+
+/*
+ * Hand a block to the kernel and post it
+ */
+UTIL_SAFE
+static os_bool_t mailbox_send( msgq_cblk_t *p_msgq, void *p_block, bool_t block,
+		os_uint_t timeout )
+{
+	os_bool_t ret = false;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_block
+	 */
+	UTIL_ASSERT( p_block != NULL );
+
+	/* owned by the kernel while in the mailbox */
+	if( mpool_lock( &g_mpool, &g_sch ) )
+	{
+		ret = mpool_transfer( p_block, &g_mlst );
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	if( ret )
+	{
+		ret = msgq_send( p_msgq, &p_block, 0, block, timeout );
+
+		/* not posted, the sender keeps the block */
+		if( !ret && mpool_lock( &g_mpool, &g_sch ) )
+		{
+			mpool_transfer( p_block, &g_sch.p_current->mlst );
+			mpool_unlock( &g_mpool, &g_sch );
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Take a block from the mailbox and give it to the calling thread
+ */
+UTIL_SAFE
+static void *mailbox_receive( msgq_cblk_t *p_msgq, bool_t block, os_uint_t timeout )
+{
+	void *p_ret = NULL;
+
+	if( msgq_receive( p_msgq, &p_ret, 0, block, timeout ) )
+	{
+		/* stays with the kernel if the list cannot take it */
+		if( mpool_lock( &g_mpool, &g_sch ) )
+		{
+			mpool_transfer( p_ret, &g_sch.p_current->mlst );
+			mpool_unlock( &g_mpool, &g_sch );
+		}
+	}
+
+	return p_ret;
+}
+
+UTIL_SAFE
+os_bool_t os_mailbox_send( os_handle_t h_mailbox, void *p_block, os_uint_t timeout )
+{
+	return mailbox_send( (msgq_cblk_t*)h_mailbox, p_block, true, timeout );
+}
+
+UTIL_SAFE
+os_bool_t os_mailbox_send_nb( os_handle_t h_mailbox, void *p_block )
+{
+	return mailbox_send( (msgq_cblk_t*)h_mailbox, p_block, false, 0 );
+}
+
+UTIL_SAFE
+void *os_mailbox_receive( os_handle_t h_mailbox, os_uint_t timeout )
+{
+	return mailbox_receive( (msgq_cblk_t*)h_mailbox, true, timeout );
+}
+
+UTIL_SAFE
+void *os_mailbox_receive_nb( os_handle_t h_mailbox )
+{
+	return mailbox_receive( (msgq_cblk_t*)h_mailbox, false, 0 );
+}
@@ -107,16 +107,17 @@ os_handle_t os_mutex_create( void )
 {
 	mutex_cblk_t *p_mutex;
 
-	UTIL_LOCK_EVERYTHING();
-	p_mutex = mpool_alloc( sizeof(mutex_cblk_t), &g_mpool, &g_mlst );
+	p_mutex = mpool_lock_alloc( sizeof(mutex_cblk_t), &g_mpool, &g_mlst, MPOOL_TRANSIENT, &g_sch );
 
 	if( p_mutex != NULL )
 	{
+		MPOOL_TAG( p_mutex, OSPORT_CALLER_ADDRESS() );
+
+		UTIL_LOCK_EVERYTHING();
 		mutex_init(p_mutex);
+		UTIL_UNLOCK_EVERYTHING();
 	}
 
-	UTIL_UNLOCK_EVERYTHING();
-
 	return (os_handle_t)p_mutex;
 }
 
@@ -143,10 +144,10 @@ void os_mutex_delete( os_handle_t h_mutex )
 
 	UTIL_LOCK_EVERYTHING();
 	mutex_delete_static( p_mutex, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
 
 	/* free memory */
-	mpool_free( p_mutex, &g_mpool);
-	UTIL_UNLOCK_EVERYTHING();
+	mpool_lock_free( p_mutex, &g_mpool, &g_sch );
 }
 
 /**
@@ -242,8 +243,8 @@ void os_mutex_unlock(os_handle_t h_mutex)
 					 * If failed:
 					 * Cannot obtain schinfo
 					 */
-					UTIL_ASSERT( p_thd->p_schinfo != NULL );
-					p_schinfo = p_thd->p_schinfo;
+					UTIL_ASSERT( p_mutex->q_wait.p_head->p_schinfo != NULL );
+					p_schinfo = p_mutex->q_wait.p_head->p_schinfo;
 
 					p_schinfo->result = true;
 					thd_ready(p_thd, &g_sch);
@@ -0,0 +1,393 @@
+/** ************************************************************************
+ * @file objq.c
+ * @brief Object queue, fixed-size blocks passed by handle
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#include "../include/objq.h"
+#include "../include/global.h"
+#include "../include/api.h"
+
+/*
+ * Initialize object queue, block_size must keep blocks aligned
+ * for a pointer
+ */
+UTIL_UNSAFE
+void objq_init( objq_cblk_t *p_objq, void *p_blocks, void *p_slots, uint_t block_size, uint_t block_count )
+{
+	uint_t i;
+	byte_t *p_block;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+	UTIL_ASSERT( p_blocks != NULL );
+	UTIL_ASSERT( block_size >= sizeof(void*) );
+	UTIL_ASSERT( block_size % sizeof(void*) == 0 );
+	UTIL_ASSERT( block_count != 0 );
+
+	p_objq->p_blocks = (byte_t*)p_blocks;
+	p_objq->block_size = block_size;
+	p_objq->block_count = block_count;
+	p_objq->num_free = block_count;
+
+	/* link every block into the free list, in address order */
+	p_objq->p_free = NULL;
+	for( i = block_count; i != 0; i-- )
+	{
+		p_block = p_objq->p_blocks + (i - 1) * block_size;
+		*(void**)p_block = p_objq->p_free;
+		p_objq->p_free = p_block;
+	}
+
+	/* every block fits the handle queue, sending never waits */
+	msgq_init( &p_objq->msgq, p_slots, sizeof(void*), block_count );
+	sch_q_init( &p_objq->q_wait_alloc );
+}
+
+/*
+ * Delete a static object queue
+ */
+UTIL_UNSAFE
+void objq_delete_static( objq_cblk_t *p_objq, sch_cblk_t *p_sch )
+{
+	sch_qitem_t *p_item;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_objq or p_sch
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	/* ready all allocating threads */
+	while( p_objq->q_wait_alloc.p_head != NULL )
+	{
+		p_item = p_objq->q_wait_alloc.p_head;
+
+		/*
+		 * If failed:
+		 * cannot obtain thread from item
+		 */
+		UTIL_ASSERT( p_item->p_thd != NULL );
+
+		thd_ready( p_item->p_thd, p_sch );
+	}
+
+	/* ready all receiving threads */
+	msgq_delete_static( &p_objq->msgq, p_sch );
+}
+
+/*
+ * Take a block from the free list, returns NULL if none is free
+ */
+UTIL_UNSAFE
+void *objq_alloc( objq_cblk_t *p_objq )
+{
+	void *p_ret;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_objq
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+
+	p_ret = p_objq->p_free;
+
+	if( p_ret != NULL )
+	{
+		p_objq->p_free = *(void**)p_ret;
+		p_objq->num_free--;
+	}
+
+	return p_ret;
+}
+
+/*
+ * Return a block, it goes straight to the first thread
+ * waiting to allocate if there is one
+ */
+UTIL_UNSAFE
+void objq_free( objq_cblk_t *p_objq, void *p_block, sch_cblk_t *p_sch )
+{
+	sch_qitem_t *p_item;
+	queue_schinfo_read_t *p_allocinfo;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	/*
+	 * If failed:
+	 * Block does not belong to this object queue
+	 */
+	UTIL_ASSERT( (byte_t*)p_block >= p_objq->p_blocks );
+	UTIL_ASSERT( (byte_t*)p_block < p_objq->p_blocks + p_objq->block_size * p_objq->block_count );
+	UTIL_ASSERT( ((byte_t*)p_block - p_objq->p_blocks) % p_objq->block_size == 0 );
+
+	p_item = p_objq->q_wait_alloc.p_head;
+
+	if( p_item != NULL )
+	{
+		/*
+		 * If failed:
+		 * cannot obtain thread or alloc info
+		 */
+		UTIL_ASSERT( p_item->p_thd != NULL );
+		UTIL_ASSERT( p_item->p_schinfo != NULL );
+		p_allocinfo = p_item->p_schinfo;
+
+		*(void**)p_allocinfo->p_data = p_block;
+		p_allocinfo->result = true;
+		thd_ready( p_item->p_thd, p_sch );
+		sch_reschedule_req( p_sch );
+	}
+	else
+	{
+		/*
+		 * If failed:
+		 * Block freed twice
+		 */
+		UTIL_ASSERT( p_objq->num_free < p_objq->block_count );
+
+		*(void**)p_block = p_objq->p_free;
+		p_objq->p_free = p_block;
+		p_objq->num_free++;
+	}
+}
+
+UTIL_SAFE
+os_handle_t os_objq_create( os_uint_t block_size, os_uint_t block_count )
+{
+	objq_cblk_t *p_objq = NULL;
+	byte_t *p_buffer = NULL;
+	uint_t slots = 0;
+	bool_t fits = false;
+
+	/*
+	 * If failed:
+	 * Invalid block count
+	 */
+	UTIL_ASSERT( block_count != 0 );
+
+	/* blocks hold the free list link */
+	if( block_size < sizeof(void*) )
+		block_size = sizeof(void*);
+
+	/* written to avoid overflowing on large requests */
+	if( (block_size <= MPOOL_SIZE_MAX) && (block_count <= MPOOL_SIZE_MAX / sizeof(void*)) )
+	{
+		/* handle slots come first, then the blocks, all aligned */
+		block_size = MPOOL_ALIGN(block_size);
+		slots = MPOOL_ALIGN(block_count * sizeof(void*));
+		fits = (slots <= MPOOL_SIZE_MAX) &&
+				(block_count <= (MPOOL_SIZE_MAX - slots) / block_size);
+	}
+
+	if( fits && mpool_lock( &g_mpool, &g_sch ) )
+	{
+		p_objq = mpool_alloc( sizeof(objq_cblk_t), &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+		if( p_objq != NULL )
+		{
+			p_buffer = mpool_alloc( slots + block_size * block_count,
+					&g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+			if( p_buffer == NULL )
+			{
+				mpool_free( p_objq, &g_mpool );
+				p_objq = NULL;
+			}
+			else
+			{
+				MPOOL_TAG( p_objq, OSPORT_CALLER_ADDRESS() );
+				MPOOL_TAG( p_buffer, OSPORT_CALLER_ADDRESS() );
+			}
+		}
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	if( p_objq != NULL )
+	{
+		UTIL_LOCK_EVERYTHING();
+		objq_init( p_objq, p_buffer + slots, p_buffer, block_size, block_count );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return (os_handle_t)p_objq;
+}
+
+UTIL_SAFE
+void os_objq_delete( os_handle_t h_objq )
+{
+	objq_cblk_t *p_objq;
+	p_objq = (objq_cblk_t*)h_objq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_objq
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	objq_delete_static( p_objq, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+
+	/* slots start the buffer */
+	mpool_lock_free( p_objq->msgq.p_buffer, &g_mpool, &g_sch );
+	mpool_lock_free( p_objq, &g_mpool, &g_sch );
+}
+
+/*
+ * Allocate a block, waiting for one to be freed if none is left
+ */
+UTIL_SAFE
+static void *objq_alloc_wait( objq_cblk_t *p_objq, bool_t block, os_uint_t timeout )
+{
+	void *p_ret = NULL;
+	queue_schinfo_read_t schinfo;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_objq
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	p_ret = objq_alloc( p_objq );
+
+	if( (p_ret == NULL) && block )
+	{
+		queue_schinfo_read_init( &schinfo, 0 );
+		schinfo.p_data = (byte_t*)&p_ret;
+		schinfo.size = sizeof(void*);
+		thd_block_current( &p_objq->q_wait_alloc, &schinfo, timeout, &g_sch );
+
+		if( !schinfo.result )
+			p_ret = NULL;
+	}
+	UTIL_UNLOCK_EVERYTHING();
+
+	return p_ret;
+}
+
+UTIL_SAFE
+void *os_objq_alloc( os_handle_t h_objq, os_uint_t timeout )
+{
+	return objq_alloc_wait( (objq_cblk_t*)h_objq, true, timeout );
+}
+
+UTIL_SAFE
+void *os_objq_alloc_nb( os_handle_t h_objq )
+{
+	return objq_alloc_wait( (objq_cblk_t*)h_objq, false, 0 );
+}
+
+UTIL_SAFE
+void os_objq_free( os_handle_t h_objq, void *p_block )
+{
+	objq_cblk_t *p_objq;
+	p_objq = (objq_cblk_t*)h_objq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_objq or p_block
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+	UTIL_ASSERT( p_block != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	objq_free( p_objq, p_block, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+}
+
+UTIL_SAFE
+void os_objq_send( os_handle_t h_objq, void *p_block )
+{
+	objq_cblk_t *p_objq;
+	p_objq = (objq_cblk_t*)h_objq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_objq or p_block
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+	UTIL_ASSERT( p_block != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+
+	/*
+	 * If failed:
+	 * Block sent twice, or not allocated from this object queue
+	 */
+	UTIL_ASSERT( p_objq->msgq.count < p_objq->msgq.item_count );
+
+	msgq_write( &p_objq->msgq, (const byte_t*)&p_block );
+	msgq_unlock_threads( &p_objq->msgq, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+}
+
+UTIL_SAFE
+void *os_objq_receive( os_handle_t h_objq, os_uint_t timeout )
+{
+	objq_cblk_t *p_objq;
+	void *p_ret = NULL;
+	p_objq = (objq_cblk_t*)h_objq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_objq
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+
+	if( !os_msgq_receive( (os_handle_t)&p_objq->msgq, &p_ret, timeout ) )
+		p_ret = NULL;
+
+	return p_ret;
+}
+
+UTIL_SAFE
+void *os_objq_receive_nb( os_handle_t h_objq )
+{
+	objq_cblk_t *p_objq;
+	void *p_ret = NULL;
+	p_objq = (objq_cblk_t*)h_objq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_objq
+	 */
+	UTIL_ASSERT( p_objq != NULL );
+
+	if( !os_msgq_receive_nb( (os_handle_t)&p_objq->msgq, &p_ret ) )
+		p_ret = NULL;
+
+	return p_ret;
+}
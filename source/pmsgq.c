@@ -0,0 +1,404 @@
+/** ************************************************************************
+ * @file pmsgq.c
+ * @brief Priority message queue
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#include "../include/pmsgq.h"
+#include "../include/msgq.h"
+#include "../include/global.h"
+#include "../include/api.h"
+
+/*
+ * Initialize priority message queue, all slots start on the free list
+ */
+UTIL_UNSAFE
+void pmsgq_init( pmsgq_cblk_t *p_pmsgq, void *p_buffer, uint_t *p_link, uint_t item_size, uint_t item_count )
+{
+	uint_t i;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_pmsgq != NULL );
+	UTIL_ASSERT( p_link != NULL );
+	UTIL_ASSERT( item_size != 0 );
+	UTIL_ASSERT( item_count != 0 );
+
+	p_pmsgq->p_buffer = (byte_t*)p_buffer;
+	p_pmsgq->p_link = p_link;
+	p_pmsgq->item_size = item_size;
+	p_pmsgq->item_count = item_count;
+	p_pmsgq->count = 0;
+	p_pmsgq->bitmap = 0;
+
+	for( i = 0; i < item_count - 1; i++ )
+		p_link[i] = i + 1;
+	p_link[item_count - 1] = PMSGQ_NONE;
+	p_pmsgq->free = 0;
+
+	for( i = 0; i < OSPORT_PMSGQ_NUM_PRIOS; i++ )
+	{
+		p_pmsgq->head[i] = PMSGQ_NONE;
+		p_pmsgq->tail[i] = PMSGQ_NONE;
+	}
+
+	sch_q_init( &p_pmsgq->q_wait_read );
+	sch_q_init( &p_pmsgq->q_wait_write );
+}
+
+/*
+ * Delete a static priority message queue
+ */
+UTIL_UNSAFE
+void pmsgq_delete_static( pmsgq_cblk_t *p_pmsgq, sch_cblk_t *p_sch )
+{
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_pmsgq or p_sch
+	 */
+	UTIL_ASSERT( p_pmsgq != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	msgq_ready_all( &p_pmsgq->q_wait_read, &p_pmsgq->q_wait_write, p_sch );
+}
+
+/*
+ * Write an item after the last one of its priority
+ */
+UTIL_UNSAFE
+void pmsgq_write( pmsgq_cblk_t *p_pmsgq, const byte_t *p_data, uint_t prio )
+{
+	uint_t slot;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_pmsgq != NULL );
+	UTIL_ASSERT( p_data != NULL );
+	UTIL_ASSERT( prio < OSPORT_PMSGQ_NUM_PRIOS );
+
+	/*
+	 * If failed:
+	 * Invalid buffer or queue full
+	 */
+	UTIL_ASSERT( p_pmsgq->p_buffer != NULL );
+	UTIL_ASSERT( p_pmsgq->free != PMSGQ_NONE );
+
+	slot = p_pmsgq->free;
+	p_pmsgq->free = p_pmsgq->p_link[slot];
+
+	util_copy( p_pmsgq->p_buffer + slot * p_pmsgq->item_size, p_data, p_pmsgq->item_size );
+
+	p_pmsgq->p_link[slot] = PMSGQ_NONE;
+	if( p_pmsgq->tail[prio] == PMSGQ_NONE )
+	{
+		p_pmsgq->head[prio] = slot;
+		p_pmsgq->bitmap |= ((uint_t)1 << prio);
+	}
+	else
+		p_pmsgq->p_link[p_pmsgq->tail[prio]] = slot;
+	p_pmsgq->tail[prio] = slot;
+
+	p_pmsgq->count++;
+}
+
+/*
+ * Remove the first item of the highest priority, 0 being the highest
+ */
+UTIL_UNSAFE
+void pmsgq_read( pmsgq_cblk_t *p_pmsgq, byte_t *p_data )
+{
+	uint_t prio = 0, slot;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_pmsgq != NULL );
+	UTIL_ASSERT( p_data != NULL );
+
+	/*
+	 * If failed:
+	 * Invalid buffer or queue empty
+	 */
+	UTIL_ASSERT( p_pmsgq->p_buffer != NULL );
+	UTIL_ASSERT( p_pmsgq->bitmap != 0 );
+
+	/* lowest set bit */
+	while( (p_pmsgq->bitmap & ((uint_t)1 << prio)) == 0 )
+		prio++;
+
+	slot = p_pmsgq->head[prio];
+	util_copy( p_data, p_pmsgq->p_buffer + slot * p_pmsgq->item_size, p_pmsgq->item_size );
+
+	p_pmsgq->head[prio] = p_pmsgq->p_link[slot];
+	if( p_pmsgq->head[prio] == PMSGQ_NONE )
+	{
+		p_pmsgq->tail[prio] = PMSGQ_NONE;
+		p_pmsgq->bitmap &= ~((uint_t)1 << prio);
+	}
+
+	p_pmsgq->p_link[slot] = p_pmsgq->free;
+	p_pmsgq->free = slot;
+
+	p_pmsgq->count--;
+}
+
+/*
+ * Store the item of a waiting writer at its priority
+ */
+UTIL_UNSAFE
+static void pmsgq_serve_write( void *p_obj, const queue_schinfo_write_t *p_writeinfo )
+{
+	pmsgq_write( (pmsgq_cblk_t*)p_obj, p_writeinfo->p_data, p_writeinfo->prio );
+}
+
+/*
+ * Serve a waiting reader, always frees a slot
+ */
+UTIL_UNSAFE
+static bool_t pmsgq_serve_read( void *p_obj, const queue_schinfo_read_t *p_readinfo )
+{
+	pmsgq_read( (pmsgq_cblk_t*)p_obj, p_readinfo->p_data );
+	return true;
+}
+
+/*
+ * Unblock threads as long as items or slots are available
+ */
+UTIL_UNSAFE
+void pmsgq_unlock_threads( pmsgq_cblk_t *p_pmsgq, sch_cblk_t *p_sch )
+{
+	static const msgq_ops_t ops = { pmsgq_serve_write, pmsgq_serve_read };
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_pmsgq or p_sch
+	 */
+	UTIL_ASSERT( p_pmsgq != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	msgq_serve_threads( &p_pmsgq->q_wait_read, &p_pmsgq->q_wait_write, p_pmsgq,
+			&p_pmsgq->count, p_pmsgq->item_count, &ops, p_sch );
+}
+
+UTIL_SAFE
+os_handle_t os_pmsgq_create( os_uint_t item_size, os_uint_t item_count )
+{
+	pmsgq_cblk_t *p_pmsgq = NULL;
+	byte_t *p_buffer = NULL;
+	uint_t links = 0;
+	bool_t fits = false;
+
+	/*
+	 * If failed:
+	 * Invalid item size or count
+	 */
+	UTIL_ASSERT( item_size != 0 );
+	UTIL_ASSERT( item_count != 0 );
+
+	/* slot links follow the items, written to avoid overflowing on large requests */
+	if( item_count <= (MPOOL_SIZE_MAX - sizeof(uint_t)) / item_size )
+	{
+		links = item_size * item_count;
+		links = (links + sizeof(uint_t) - 1) / sizeof(uint_t) * sizeof(uint_t);
+		fits = (item_count <= (MPOOL_SIZE_MAX - links) / sizeof(uint_t));
+	}
+
+	if( fits && mpool_lock( &g_mpool, &g_sch ) )
+	{
+		p_pmsgq = mpool_alloc( sizeof(pmsgq_cblk_t), &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+		if( p_pmsgq != NULL )
+		{
+			p_buffer = mpool_alloc( links + item_count * sizeof(uint_t),
+					&g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+			if( p_buffer == NULL )
+			{
+				mpool_free( p_pmsgq, &g_mpool );
+				p_pmsgq = NULL;
+			}
+			else
+			{
+				MPOOL_TAG( p_pmsgq, OSPORT_CALLER_ADDRESS() );
+				MPOOL_TAG( p_buffer, OSPORT_CALLER_ADDRESS() );
+			}
+		}
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	if( p_pmsgq != NULL )
+	{
+		UTIL_LOCK_EVERYTHING();
+		pmsgq_init( p_pmsgq, p_buffer, (uint_t*)(p_buffer + links), item_size, item_count );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return (os_handle_t)p_pmsgq;
+}
+
+UTIL_SAFE
+void os_pmsgq_delete( os_handle_t h_pmsgq )
+{
+	pmsgq_cblk_t *p_pmsgq;
+	p_pmsgq = (pmsgq_cblk_t*)h_pmsgq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_pmsgq
+	 */
+	UTIL_ASSERT( p_pmsgq != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	pmsgq_delete_static( p_pmsgq, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+
+	mpool_lock_free( p_pmsgq->p_buffer, &g_mpool, &g_sch );
+	mpool_lock_free( p_pmsgq, &g_mpool, &g_sch );
+}
+
+UTIL_SAFE
+os_uint_t os_pmsgq_get_count( os_handle_t h_pmsgq )
+{
+	pmsgq_cblk_t *p_pmsgq;
+	uint_t ret;
+	p_pmsgq = (pmsgq_cblk_t*)h_pmsgq;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_pmsgq
+	 */
+	UTIL_ASSERT( p_pmsgq != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	ret = p_pmsgq->count;
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+/*
+ * Send an item with a priority
+ */
+UTIL_SAFE
+static os_bool_t pmsgq_send( pmsgq_cblk_t *p_pmsgq, const void *p_data, uint_t prio,
+		bool_t block, os_uint_t timeout )
+{
+	os_bool_t ret = false;
+	queue_schinfo_write_t schinfo;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_pmsgq or p_data, or invalid priority
+	 */
+	UTIL_ASSERT( p_pmsgq != NULL );
+	UTIL_ASSERT( p_data != NULL );
+	UTIL_ASSERT( prio < OSPORT_PMSGQ_NUM_PRIOS );
+
+	UTIL_LOCK_EVERYTHING();
+	if( p_pmsgq->count < p_pmsgq->item_count )
+	{
+		pmsgq_write( p_pmsgq, p_data, prio );
+		pmsgq_unlock_threads( p_pmsgq, &g_sch );
+		ret = true;
+	}
+	else if( block )
+	{
+		queue_schnifo_write_init( &schinfo, 0 );
+		schinfo.p_data = p_data;
+		schinfo.size = p_pmsgq->item_size;
+		schinfo.prio = prio;
+		thd_block_current( &p_pmsgq->q_wait_write, &schinfo, timeout, &g_sch );
+		ret = schinfo.result;
+	}
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+/*
+ * Receive the most urgent item
+ */
+UTIL_SAFE
+static os_bool_t pmsgq_receive( pmsgq_cblk_t *p_pmsgq, void *p_data,
+		bool_t block, os_uint_t timeout )
+{
+	os_bool_t ret = false;
+	queue_schinfo_read_t schinfo;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_pmsgq or p_data
+	 */
+	UTIL_ASSERT( p_pmsgq != NULL );
+	UTIL_ASSERT( p_data != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	if( p_pmsgq->count != 0 )
+	{
+		pmsgq_read( p_pmsgq, p_data );
+		pmsgq_unlock_threads( p_pmsgq, &g_sch );
+		ret = true;
+	}
+	else if( block )
+	{
+		queue_schinfo_read_init( &schinfo, 0 );
+		schinfo.p_data = p_data;
+		schinfo.size = p_pmsgq->item_size;
+		thd_block_current( &p_pmsgq->q_wait_read, &schinfo, timeout, &g_sch );
+		ret = schinfo.result;
+	}
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+UTIL_SAFE
+os_bool_t os_pmsgq_send( os_handle_t h_pmsgq, const void *p_data, os_uint_t prio, os_uint_t timeout )
+{
+	return pmsgq_send( (pmsgq_cblk_t*)h_pmsgq, p_data, prio, true, timeout );
+}
+
+UTIL_SAFE
+os_bool_t os_pmsgq_send_nb( os_handle_t h_pmsgq, const void *p_data, os_uint_t prio )
+{
+	return pmsgq_send( (pmsgq_cblk_t*)h_pmsgq, p_data, prio, false, 0 );
+}
+
+UTIL_SAFE
+os_bool_t os_pmsgq_receive( os_handle_t h_pmsgq, void *p_data, os_uint_t timeout )
+{
+	return pmsgq_receive( (pmsgq_cblk_t*)h_pmsgq, p_data, true, timeout );
+}
+
+UTIL_SAFE
+os_bool_t os_pmsgq_receive_nb( os_handle_t h_pmsgq, void *p_data )
+{
+	return pmsgq_receive( (pmsgq_cblk_t*)h_pmsgq, p_data, false, 0 );
+}
@@ -46,6 +46,21 @@ void queue_init( queue_cblk_t *p_q, void *p_buffer, uint_t size)
 	p_q->size = size;
 	p_q->read = 0;
 	p_q->write = 0;
+	p_q->reserve = 0;
+	p_q->acquire = 0;
+	p_q->num_reserved = 0;
+	p_q->num_acquired = 0;
+	p_q->policy = QUEUE_POLICY_HEAD_OF_LINE;
+
+#if OSPORT_QUEUE_STATS
+	p_q->stats.max_used = 0;
+	p_q->stats.bytes_in = 0;
+	p_q->stats.bytes_out = 0;
+	p_q->stats.num_blocked_sends = 0;
+	p_q->stats.num_blocked_receives = 0;
+	p_q->stats.blocked_time = 0;
+	p_q->stats.num_timeouts = 0;
+#endif
 
 	sch_q_init( &p_q->q_wait_read );
 	sch_q_init( &p_q->q_wait_write );
@@ -65,6 +80,9 @@ void queue_schinfo_read_init( queue_schinfo_read_t *p_schinfo, uint_t flag )
 
 	p_schinfo->result = false;
 	p_schinfo->flag = flag;
+#if OSPORT_QUEUE_STATS
+	p_schinfo->start = g_sch.timestamp;
+#endif
 }
 
 /*
@@ -81,6 +99,9 @@ void queue_schnifo_write_init( queue_schinfo_write_t *p_schinfo, uint_t flag )
 
 	p_schinfo->result = false;
 	p_schinfo->flag = flag;
+#if OSPORT_QUEUE_STATS
+	p_schinfo->start = g_sch.timestamp;
+#endif
 }
 
 /*
@@ -129,15 +150,96 @@ void queue_delete_static( queue_cblk_t *p_q, sch_cblk_t *p_sch )
 	sch_reschedule_req(p_sch);
 }
 
+/*
+ * Data shorter than this is copied a byte at a time, which costs less
+ * than the util_copy calls
+ */
+#define QUEUE_COPY_SHORT (2*sizeof(handle_t))
+
+/*
+ * Copy data into the buffer starting at an index, in at most two
+ * segments, returns the index after the data
+ */
+UTIL_UNSAFE
+static uint_t queue_copy_in( queue_cblk_t *p_q, uint_t index, const byte_t *p_data, uint_t size )
+{
+	uint_t first;
+	uint_t counter;
+
+	if( size < QUEUE_COPY_SHORT )
+	{
+		for( counter = 0; counter < size; counter++ )
+		{
+			p_q->p_buffer[index] = p_data[counter];
+			if( ++index == p_q->size )
+				index = 0;
+		}
+	}
+	else
+	{
+		/* segment up to the end of the buffer */
+		first = p_q->size - index;
+		if( first > size )
+			first = size;
+
+		util_copy( p_q->p_buffer + index, p_data, first );
+		util_copy( p_q->p_buffer, p_data + first, size - first );
+
+		index += size;
+		if( index >= p_q->size )
+			index -= p_q->size;
+	}
+
+	return index;
+}
+
+/*
+ * Copy data out of the buffer starting at an index, in at most two
+ * segments, returns the index after the data
+ */
+UTIL_UNSAFE
+static uint_t queue_copy_out( const queue_cblk_t *p_q, uint_t index, byte_t *p_data, uint_t size )
+{
+	uint_t first;
+	uint_t counter;
+
+	if( size < QUEUE_COPY_SHORT )
+	{
+		for( counter = 0; counter < size; counter++ )
+		{
+			p_data[counter] = p_q->p_buffer[index];
+			if( ++index == p_q->size )
+				index = 0;
+		}
+	}
+	else
+	{
+		/* segment up to the end of the buffer */
+		first = p_q->size - index;
+		if( first > size )
+			first = size;
+
+		util_copy( p_data, p_q->p_buffer + index, first );
+		util_copy( p_data + first, p_q->p_buffer, size - first );
+
+		index += size;
+		if( index >= p_q->size )
+			index -= p_q->size;
+	}
+
+	return index;
+}
+
 /*
  * Write to a queue
  */
 UTIL_UNSAFE
 void queue_write( queue_cblk_t *p_q, const byte_t *p_data, uint_t size )
 {
-	uint_t counter;
-	uint_t write, qsize;
 	byte_t *p_buffer;
+	uint_t end;
+	uint_t index;
+	uint_t counter;
 
 	/*
 	 * If failed:
@@ -151,31 +253,40 @@ void queue_write( queue_cblk_t *p_q, const byte_t *p_data, uint_t size )
 	 * Invalid buffer or index
 	 */
 	UTIL_ASSERT( p_q->p_buffer != NULL );
-	UTIL_ASSERT( p_q->write < p_q->size );
+	UTIL_ASSERT( p_q->reserve < p_q->size );
 
-	write = p_q->write;
-	qsize = p_q->size;
-	p_buffer = p_q->p_buffer;
+	/* written after any reserved space, published with it */
+	index = p_q->reserve;
 
-	for( counter = 0; counter < size; counter++ )
+	/* short data is copied here, saving the call on the common path */
+	if( size < QUEUE_COPY_SHORT )
 	{
-		p_buffer[write] = p_data[counter];
-
-		if( write < qsize-1)
-			write++;
-		else
-			write = 0;
+		p_buffer = p_q->p_buffer;
+		end = p_q->size;
+		for( counter = 0; counter < size; counter++ )
+		{
+			p_buffer[index] = p_data[counter];
+			if( ++index == end )
+				index = 0;
+		}
+	}
+	else
+	{
+		index = queue_copy_in( p_q, index, p_data, size );
 	}
 
-	p_q->write = write;
+	p_q->reserve = index;
+
+	if( p_q->num_reserved == 0 )
+		p_q->write = index;
+
+	QUEUE_STATS_IN( p_q, size );
 }
 
 UTIL_UNSAFE
 void queue_write_ahead( queue_cblk_t *p_q, const byte_t *p_data, uint_t size )
 {
-	uint_t counter;
-	uint_t read, qsize;
-	byte_t *p_buffer;
+	uint_t read;
 
 	/*
 	 * If failed:
@@ -191,65 +302,136 @@ void queue_write_ahead( queue_cblk_t *p_q, const byte_t *p_data, uint_t size )
 	UTIL_ASSERT( p_q->p_buffer != NULL );
 	UTIL_ASSERT( p_q->read < p_q->size );
 
-	read = p_q->read;
-	p_buffer = p_q->p_buffer;
-	qsize = p_q->size;
+	/*
+	 * If failed:
+	 * Writing ahead of acquired data, check queue_get_ahead_size
+	 */
+	UTIL_ASSERT( p_q->num_acquired == 0 );
 
-	for( counter = size; counter > 0; counter--)
-	{
-		if(read > 0)
-			read--;
-		else
-			read = qsize-1;
+	/* move the read index back, then copy forward from it */
+	if( p_q->read >= size )
+		read = p_q->read - size;
+	else
+		read = p_q->read + p_q->size - size;
 
-		p_buffer[read] = p_data[counter-1];
-	}
+	queue_copy_in( p_q, read, p_data, size );
 
 	p_q->read = read;
+	p_q->acquire = read;
 
+	QUEUE_STATS_IN( p_q, size );
 }
 
+/*
+ * Write a list of segments to a queue as one piece of data
+ */
 UTIL_UNSAFE
-void queue_peek( const queue_cblk_t *p_q, byte_t *p_data, uint_t size )
+void queue_writev( queue_cblk_t *p_q, const queue_seg_t *p_seg, uint_t num )
 {
-	uint_t counter;
-	uint_t read, qsize;
-	byte_t *p_buffer;
+	uint_t i;
 
 	/*
 	 * If failed:
 	 * Invalid parameters
 	 */
 	UTIL_ASSERT( p_q != NULL );
+	UTIL_ASSERT( (p_seg != NULL) || (num == 0) );
 
 	/*
 	 * If failed:
 	 * Invalid buffer or index
 	 */
 	UTIL_ASSERT( p_q->p_buffer != NULL );
-	UTIL_ASSERT( p_q->read < p_q->size );
+	UTIL_ASSERT( p_q->reserve < p_q->size );
 
-	read = p_q->read;
-	qsize = p_q->size;
-	p_buffer = p_q->p_buffer;
-
-	for( counter = 0; counter < size; counter++ )
+	for( i = 0; i < num; i++ )
 	{
-		p_data[counter] = p_buffer[read];
+		p_q->reserve = queue_copy_in( p_q, p_q->reserve, p_seg[i].p_data, p_seg[i].size );
+		QUEUE_STATS_IN( p_q, p_seg[i].size );
+	}
 
-		if( read < qsize-1)
-			read++;
-		else
-			read = 0;
+	if( p_q->num_reserved == 0 )
+		p_q->write = p_q->reserve;
+}
+
+/*
+ * Read from a queue into a list of segments
+ */
+UTIL_UNSAFE
+void queue_readv( queue_cblk_t *p_q, const queue_seg_t *p_seg, uint_t num )
+{
+	uint_t i;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_q != NULL );
+	UTIL_ASSERT( (p_seg != NULL) || (num == 0) );
+
+	/*
+	 * If failed:
+	 * Invalid buffer or index
+	 */
+	UTIL_ASSERT( p_q->p_buffer != NULL );
+	UTIL_ASSERT( p_q->acquire < p_q->size );
+
+	for( i = 0; i < num; i++ )
+	{
+		p_q->acquire = queue_copy_out( p_q, p_q->acquire, p_seg[i].p_data, p_seg[i].size );
+		QUEUE_STATS_OUT( p_q, p_seg[i].size );
 	}
+
+	if( p_q->num_acquired == 0 )
+		p_q->read = p_q->acquire;
+}
+
+/*
+ * Total size of a list of segments
+ */
+UTIL_UNSAFE
+uint_t queue_get_seg_size( const queue_seg_t *p_seg, uint_t num )
+{
+	uint_t i, ret = 0;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_seg
+	 */
+	UTIL_ASSERT( (p_seg != NULL) || (num == 0) );
+
+	for( i = 0; i < num; i++ )
+		ret += p_seg[i].size;
+
+	return ret;
+}
+
+UTIL_UNSAFE
+void queue_peek( const queue_cblk_t *p_q, byte_t *p_data, uint_t size )
+{
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_q != NULL );
+
+	/*
+	 * If failed:
+	 * Invalid buffer or index
+	 */
+	UTIL_ASSERT( p_q->p_buffer != NULL );
+	UTIL_ASSERT( p_q->acquire < p_q->size );
+
+	queue_copy_out( p_q, p_q->acquire, p_data, size );
 }
 
 UTIL_UNSAFE
 void queue_read( queue_cblk_t *p_q, byte_t *p_data, uint_t size )
 {
+	const byte_t *p_buffer;
+	uint_t end;
+	uint_t index;
 	uint_t counter;
-	uint_t read, qsize;
-	byte_t *p_buffer;
 
 	/*
 	 * If failed:
@@ -263,23 +445,150 @@ void queue_read( queue_cblk_t *p_q, byte_t *p_data, uint_t size )
 	 * Invalid buffer or index
 	 */
 	UTIL_ASSERT( p_q->p_buffer != NULL );
-	UTIL_ASSERT( p_q->read < p_q->size );
+	UTIL_ASSERT( p_q->acquire < p_q->size );
 
-	read = p_q->read;
-	qsize = p_q->size;
-	p_buffer = p_q->p_buffer;
+	/* read after any acquired data, released with it */
+	index = p_q->acquire;
 
-	for( counter = 0; counter < size; counter++ )
+	/* short data is copied here, saving the call on the common path */
+	if( size < QUEUE_COPY_SHORT )
 	{
-		p_data[counter] = p_buffer[read];
-
-		if( read < qsize-1)
-			read++;
-		else
-			read = 0;
+		p_buffer = p_q->p_buffer;
+		end = p_q->size;
+		for( counter = 0; counter < size; counter++ )
+		{
+			p_data[counter] = p_buffer[index];
+			if( ++index == end )
+				index = 0;
+		}
+	}
+	else
+	{
+		index = queue_copy_out( p_q, index, p_data, size );
 	}
 
-	p_q->read = read;
+	p_q->acquire = index;
+
+	if( p_q->num_acquired == 0 )
+		p_q->read = index;
+
+	QUEUE_STATS_OUT( p_q, size );
+}
+
+/*
+ * Describe the buffer space starting at an index,
+ * returns the index after the span
+ */
+UTIL_UNSAFE
+static uint_t queue_span( const queue_cblk_t *p_q, uint_t index, uint_t size, queue_span_t *p_span )
+{
+	uint_t first;
+
+	/* part up to the end of the buffer */
+	first = p_q->size - index;
+	if( first > size )
+		first = size;
+
+	p_span->p_data[0] = p_q->p_buffer + index;
+	p_span->size[0] = first;
+	p_span->p_data[1] = p_q->p_buffer;
+	p_span->size[1] = size - first;
+
+	index += size;
+	if( index >= p_q->size )
+		index -= p_q->size;
+
+	return index;
+}
+
+/*
+ * Reserve free space to be written in place
+ */
+UTIL_UNSAFE
+void queue_reserve( queue_cblk_t *p_q, uint_t size, queue_span_t *p_span )
+{
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_q != NULL );
+	UTIL_ASSERT( p_span != NULL );
+	UTIL_ASSERT( size <= queue_get_free_size(p_q) );
+
+	p_q->reserve = queue_span( p_q, p_q->reserve, size, p_span );
+	p_q->num_reserved++;
+
+	QUEUE_STATS_IN( p_q, size );
+}
+
+/*
+ * Commit a reservation, the reserved data is published when
+ * the last outstanding reservation is committed
+ */
+UTIL_UNSAFE
+bool_t queue_commit( queue_cblk_t *p_q )
+{
+	bool_t ret;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q, or nothing reserved
+	 */
+	UTIL_ASSERT( p_q != NULL );
+	UTIL_ASSERT( p_q->num_reserved != 0 );
+
+	p_q->num_reserved--;
+	ret = (p_q->num_reserved == 0);
+
+	if( ret )
+		p_q->write = p_q->reserve;
+
+	return ret;
+}
+
+/*
+ * Acquire data to be read in place
+ */
+UTIL_UNSAFE
+void queue_acquire( queue_cblk_t *p_q, uint_t size, queue_span_t *p_span )
+{
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_q != NULL );
+	UTIL_ASSERT( p_span != NULL );
+	UTIL_ASSERT( size <= queue_get_used_size(p_q) );
+
+	p_q->acquire = queue_span( p_q, p_q->acquire, size, p_span );
+	p_q->num_acquired++;
+
+	QUEUE_STATS_OUT( p_q, size );
+}
+
+/*
+ * Release acquired data, the space is freed when the last
+ * outstanding acquisition is released
+ */
+UTIL_UNSAFE
+bool_t queue_release( queue_cblk_t *p_q )
+{
+	bool_t ret;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q, or nothing acquired
+	 */
+	UTIL_ASSERT( p_q != NULL );
+	UTIL_ASSERT( p_q->num_acquired != 0 );
+
+	p_q->num_acquired--;
+	ret = (p_q->num_acquired == 0);
+
+	if( ret )
+		p_q->read = p_q->acquire;
+
+	return ret;
 }
 
 UTIL_UNSAFE
@@ -293,8 +602,9 @@ uint_t queue_get_used_size(const queue_cblk_t *p_q )
 	 */
 	UTIL_ASSERT( p_q != NULL );
 
+	/* published data not acquired yet */
 	write = p_q->write;
-	read = p_q->read;
+	read = p_q->acquire;
 	size = p_q->size;
 
 	if( write >= read )
@@ -315,7 +625,8 @@ uint_t queue_get_free_size(const queue_cblk_t *p_q )
 	 */
 	UTIL_ASSERT( p_q != NULL );
 
-	write = p_q->write;
+	/* space neither reserved nor holding unreleased data */
+	write = p_q->reserve;
 	read = p_q->read;
 	size = p_q->size;
 
@@ -327,12 +638,9 @@ uint_t queue_get_free_size(const queue_cblk_t *p_q )
 }
 
 UTIL_UNSAFE
-void queue_unlock_threads( queue_cblk_t *p_q, sch_cblk_t *p_sch )
+uint_t queue_get_ahead_size(const queue_cblk_t *p_q )
 {
-	bool_t can_read = true, can_write = true;
-	thd_cblk_t *p_thd;
-	queue_schinfo_read_t *p_readinfo;
-	queue_schinfo_write_t *p_writeinfo;
+	uint_t ret = 0;
 
 	/*
 	 * If failed:
@@ -340,92 +648,316 @@ void queue_unlock_threads( queue_cblk_t *p_q, sch_cblk_t *p_sch )
 	 */
 	UTIL_ASSERT( p_q != NULL );
 
-	while( can_read || can_write )
-	{
-		if( can_write)
-		{
-			/* has writing threads */
-			if( p_q->q_wait_write.p_head != NULL )
-			{
-				/*
-				 * If failed:
-				 * cannot obtain thread
-				 */
-				UTIL_ASSERT( p_q->q_wait_write.p_head->p_thd != NULL );
-				p_thd = p_q->q_wait_write.p_head->p_thd;
+	/* data written ahead would land behind acquired data */
+	if( p_q->num_acquired == 0 )
+		ret = queue_get_free_size(p_q);
 
-				/*
-				 * If failed:
-				 * write info missing
-				 */
-				UTIL_ASSERT(p_thd->p_schinfo != NULL );
-				p_writeinfo = p_thd->p_schinfo;
+	return ret;
+}
 
-				/* has free space */
-				if( p_writeinfo->size <= queue_get_free_size(p_q) )
-				{
-					/* check flags */
-					if( p_writeinfo->flag & QUEUE_WRITE_AHEAD )
-						queue_write_ahead( p_q, p_writeinfo->p_data, p_writeinfo->size );
-					else
-						queue_write( p_q, p_writeinfo->p_data, p_writeinfo->size );
+/*
+ * Write to a queue, data for readers blocked on an empty queue
+ * is copied straight to them instead of through the buffer
+ */
+UTIL_UNSAFE
+void queue_write_handoff( queue_cblk_t *p_q, const byte_t *p_data, uint_t size, sch_cblk_t *p_sch )
+{
+	sch_qitem_t *p_item;
+	queue_schinfo_read_t *p_readinfo;
+	bool_t can_handoff = true;
 
-					can_read = true;
-					p_writeinfo->result = true;
-					thd_ready( p_thd, p_sch );
-				}
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_q != NULL );
+	UTIL_ASSERT( p_data != NULL );
+	UTIL_ASSERT( p_sch != NULL );
 
-				/* not enough free space */
-				else
-					can_write = false;
-			}
-			/* no writing threads */
-			else
-				can_write = false;
+	/* nothing buffered or reserved may go before this data */
+	while( can_handoff && (p_q->q_wait_read.p_head != NULL) &&
+			(p_q->num_reserved == 0) && (queue_get_used_size(p_q) == 0) )
+	{
+		p_item = p_q->q_wait_read.p_head;
 
-		} /* if (can_write) */
+		/*
+		 * If failed:
+		 * read info missing
+		 */
+		UTIL_ASSERT( p_item->p_schinfo != NULL );
+		p_readinfo = p_item->p_schinfo;
 
-		if( can_read )
+		/* plain reads only, others need the data in the buffer */
+		if( (p_readinfo->flag == 0) && (p_readinfo->size <= size) )
 		{
-			/* has reading threads */
-			if( p_q->q_wait_read.p_head != NULL )
-			{
-				/*
-				 * If failed:
-				 * cannot obtain thread
-				 */
-				UTIL_ASSERT(p_q->q_wait_read.p_head->p_thd != NULL);
-				p_thd = p_q->q_wait_read.p_head->p_thd;
+			util_copy( p_readinfo->p_data, p_data, p_readinfo->size );
+			QUEUE_STATS_IN( p_q, p_readinfo->size );
+			QUEUE_STATS_OUT( p_q, p_readinfo->size );
+			p_data += p_readinfo->size;
+			size -= p_readinfo->size;
+
+			QUEUE_STATS_WAKE( p_q, p_readinfo, p_sch );
+			p_readinfo->result = true;
+			thd_ready( p_item->p_thd, p_sch );
+		}
+		else
+			can_handoff = false;
+	}
 
-				/*
-				 * If failed:
-				 * read info missing
-				 */
-				UTIL_ASSERT( p_thd->p_schinfo != NULL );
-				p_readinfo = p_thd->p_schinfo;
+	if( size != 0 )
+		queue_write( p_q, p_data, size );
+}
 
-				/* has data */
-				if( p_readinfo->size <= queue_get_used_size(p_q) )
-				{
-					/* check flags */
-					if( p_readinfo->flag & QUEUE_READ_PEEK )
-					{
-						if( p_readinfo->p_data != NULL )
-							queue_peek(p_q, p_readinfo->p_data, p_readinfo->size );
-					}
-					else
-						queue_read(p_q, p_readinfo->p_data, p_readinfo->size );
+/*
+ * Read from an empty queue with no waiting readers, taking the data
+ * straight from the writer blocked at the head, returns false if not
+ * possible
+ */
+UTIL_UNSAFE
+bool_t queue_read_handoff( queue_cblk_t *p_q, byte_t *p_data, uint_t size, sch_cblk_t *p_sch )
+{
+	sch_qitem_t *p_item;
+	queue_schinfo_write_t *p_writeinfo;
+	bool_t ret = false;
 
-					can_write = true;
-					p_readinfo->result = true;
-					thd_ready( p_thd, p_sch );
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_q != NULL );
+	UTIL_ASSERT( p_data != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	p_item = p_q->q_wait_write.p_head;
+
+	/*
+	 * the writer's data would be next in the queue, and readers
+	 * already waiting are served first
+	 */
+	if( (p_item != NULL) && (p_q->q_wait_read.p_head == NULL) &&
+			(p_q->num_reserved == 0) && (queue_get_used_size(p_q) == 0) )
+	{
+		/*
+		 * If failed:
+		 * write info missing
+		 */
+		UTIL_ASSERT( p_item->p_schinfo != NULL );
+		p_writeinfo = p_item->p_schinfo;
+
+		/* the rest of the message must fit the buffer */
+		if( (p_writeinfo->flag == 0) && (p_writeinfo->size >= size) &&
+				(p_writeinfo->size - size <= queue_get_free_size(p_q)) )
+		{
+			util_copy( p_data, p_writeinfo->p_data, size );
+			QUEUE_STATS_IN( p_q, size );
+			QUEUE_STATS_OUT( p_q, size );
+
+			if( p_writeinfo->size != size )
+				queue_write( p_q, p_writeinfo->p_data + size, p_writeinfo->size - size );
+
+			QUEUE_STATS_WAKE( p_q, p_writeinfo, p_sch );
+			p_writeinfo->result = true;
+			thd_ready( p_item->p_thd, p_sch );
+			ret = true;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Find the waiting writer to serve, only the first one with head-of-line
+ * service, or the first that fits among up to OSPORT_QUEUE_SCAN_MAX
+ * writers in priority order with first-fit service
+ */
+UTIL_UNSAFE
+static sch_qitem_t *queue_find_writer( const queue_cblk_t *p_q )
+{
+	sch_qitem_t *p_item, *p_ret = NULL;
+	queue_schinfo_write_t *p_writeinfo;
+	uint_t scan;
+
+	scan = (p_q->policy == QUEUE_POLICY_FIRST_FIT)? OSPORT_QUEUE_SCAN_MAX : 1;
+	p_item = p_q->q_wait_write.p_head;
+
+	while( (p_ret == NULL) && (p_item != NULL) && (scan != 0) )
+	{
+		/*
+		 * If failed:
+		 * write info missing
+		 */
+		UTIL_ASSERT( p_item->p_schinfo != NULL );
+		p_writeinfo = p_item->p_schinfo;
+
+		/* has free space */
+		if( p_writeinfo->size <= ((p_writeinfo->flag & QUEUE_WRITE_AHEAD)?
+				queue_get_ahead_size(p_q) : queue_get_free_size(p_q)) )
+			p_ret = p_item;
+		else
+		{
+			/* the wait list is circular */
+			p_item = p_item->p_next;
+			if( p_item == p_q->q_wait_write.p_head )
+				p_item = NULL;
+			scan--;
+		}
+	}
+
+	return p_ret;
+}
+
+/*
+ * Find the waiting reader to serve, the same way as writers
+ */
+UTIL_UNSAFE
+static sch_qitem_t *queue_find_reader( const queue_cblk_t *p_q )
+{
+	sch_qitem_t *p_item, *p_ret = NULL;
+	queue_schinfo_read_t *p_readinfo;
+	uint_t scan;
+
+	scan = (p_q->policy == QUEUE_POLICY_FIRST_FIT)? OSPORT_QUEUE_SCAN_MAX : 1;
+	p_item = p_q->q_wait_read.p_head;
+
+	while( (p_ret == NULL) && (p_item != NULL) && (scan != 0) )
+	{
+		/*
+		 * If failed:
+		 * read info missing
+		 */
+		UTIL_ASSERT( p_item->p_schinfo != NULL );
+		p_readinfo = p_item->p_schinfo;
+
+		/* has data */
+		if( p_readinfo->size <= queue_get_used_size(p_q) )
+			p_ret = p_item;
+		else
+		{
+			/* the wait list is circular */
+			p_item = p_item->p_next;
+			if( p_item == p_q->q_wait_read.p_head )
+				p_item = NULL;
+			scan--;
+		}
+	}
+
+	return p_ret;
+}
+
+/*
+ * Serve a stream reader with whatever is there, up to its maximum,
+ * acquired when the reader copies it with interrupts enabled
+ */
+UTIL_UNSAFE
+static void queue_serve_stream( queue_cblk_t *p_q, queue_schinfo_read_t *p_readinfo )
+{
+	p_readinfo->size = queue_get_used_size(p_q);
+	if( p_readinfo->size > p_readinfo->max )
+		p_readinfo->size = p_readinfo->max;
+
+	if( p_readinfo->flag & QUEUE_READ_ACQUIRE )
+		queue_acquire( p_q, p_readinfo->size, p_readinfo->p_span );
+	else
+		queue_read( p_q, p_readinfo->p_data, p_readinfo->size );
+}
+
+UTIL_UNSAFE
+void queue_unlock_threads( queue_cblk_t *p_q, sch_cblk_t *p_sch )
+{
+	bool_t can_read = true, can_write = true;
+	sch_qitem_t *p_item;
+	thd_cblk_t *p_thd;
+	queue_schinfo_read_t *p_readinfo;
+	queue_schinfo_write_t *p_writeinfo;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT( p_q != NULL );
+
+	while( can_read || can_write )
+	{
+		if( can_write)
+		{
+			/* has a writing thread that fits */
+			p_item = queue_find_writer( p_q );
+			if( p_item != NULL )
+			{
+				/*
+				 * If failed:
+				 * cannot obtain thread
+				 */
+				UTIL_ASSERT( p_item->p_thd != NULL );
+				p_thd = p_item->p_thd;
+				p_writeinfo = p_item->p_schinfo;
+
+				/* check flags */
+				if( p_writeinfo->flag & QUEUE_WRITE_AHEAD )
+					queue_write_ahead( p_q, p_writeinfo->p_data, p_writeinfo->size );
+				else if( p_writeinfo->flag & QUEUE_WRITE_RESERVE )
+					queue_reserve( p_q, p_writeinfo->size, p_writeinfo->p_span );
+				else if( p_writeinfo->flag & QUEUE_WRITE_VECTOR )
+					queue_writev( p_q, p_writeinfo->p_seg, p_writeinfo->num_seg );
+				else
+					queue_write( p_q, p_writeinfo->p_data, p_writeinfo->size );
+
+				/* reserved space holds no data until committed */
+				if( !(p_writeinfo->flag & QUEUE_WRITE_RESERVE) )
+					can_read = true;
+
+				QUEUE_STATS_WAKE( p_q, p_writeinfo, p_sch );
+				p_writeinfo->result = true;
+				thd_ready( p_thd, p_sch );
+			}
+
+			/* no writing threads, or not enough free space */
+			else
+				can_write = false;
+
+		} /* if (can_write) */
+
+		if( can_read )
+		{
+			/* has a reading thread that fits */
+			p_item = queue_find_reader( p_q );
+			if( p_item != NULL )
+			{
+				/*
+				 * If failed:
+				 * cannot obtain thread
+				 */
+				UTIL_ASSERT( p_item->p_thd != NULL );
+				p_thd = p_item->p_thd;
+				p_readinfo = p_item->p_schinfo;
+
+				/* check flags, a stream may also acquire */
+				if( p_readinfo->flag & QUEUE_READ_PEEK )
+				{
+					if( p_readinfo->p_data != NULL )
+						queue_peek(p_q, p_readinfo->p_data, p_readinfo->size );
 				}
+				else if( p_readinfo->flag & QUEUE_READ_STREAM )
+				{
+					/* trigger level met, take what is there and report it */
+					queue_serve_stream( p_q, p_readinfo );
+				}
+				else if( p_readinfo->flag & QUEUE_READ_ACQUIRE )
+					queue_acquire(p_q, p_readinfo->size, p_readinfo->p_span );
+				else if( p_readinfo->flag & QUEUE_READ_VECTOR )
+					queue_readv(p_q, p_readinfo->p_seg, p_readinfo->num_seg );
 				else
-					/* no data */
-					can_read = false;
+					queue_read(p_q, p_readinfo->p_data, p_readinfo->size );
+
+				/* acquired data holds its space until released */
+				if( !(p_readinfo->flag & (QUEUE_READ_PEEK | QUEUE_READ_ACQUIRE)) )
+					can_write = true;
+				QUEUE_STATS_WAKE( p_q, p_readinfo, p_sch );
+				p_readinfo->result = true;
+				thd_ready( p_thd, p_sch );
 			}
 
-			/* no reading threads */
+			/* no reading threads, or not enough data */
 			else
 				can_read = false;
 		} /* if (can_read) */
@@ -434,25 +966,166 @@ void queue_unlock_threads( queue_cblk_t *p_q, sch_cblk_t *p_sch )
 	sch_reschedule_req( p_sch);
 }
 
+#if OSPORT_QUEUE_STATS
+/*
+ * Count bytes entering the queue, after they are in
+ */
+UTIL_UNSAFE
+void queue_stats_in( queue_cblk_t *p_q, uint_t size )
+{
+	uint_t used;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT( p_q != NULL );
+
+	p_q->stats.bytes_in += size;
+
+	/* reserved and unreleased bytes hold space too */
+	used = p_q->size - 1 - queue_get_free_size(p_q);
+	if( used > p_q->stats.max_used )
+		p_q->stats.max_used = used;
+}
+
+/*
+ * Count bytes leaving the queue
+ */
+UTIL_UNSAFE
+void queue_stats_out( queue_cblk_t *p_q, uint_t size )
+{
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT( p_q != NULL );
+
+	p_q->stats.bytes_out += size;
+}
+#endif
+
+/*
+ * A writer timed out, still on the wait list so the queue is valid
+ */
+UTIL_UNSAFE
+static void queue_timeout_write( thd_cblk_t *p_thd )
+{
+#if OSPORT_QUEUE_STATS
+	queue_cblk_t *p_q;
+	queue_schinfo_write_t *p_writeinfo;
+
+	p_q = UTIL_CONTAINER_OF( p_thd->item_sch.p_q, queue_cblk_t, q_wait_write );
+	p_writeinfo = p_thd->p_schinfo;
+
+	QUEUE_STATS_WAKE( p_q, p_writeinfo, &g_sch );
+	p_q->stats.num_timeouts++;
+#else
+	(void)p_thd;
+#endif
+}
+
+/*
+ * A reader timed out, still on the wait list so the queue is valid.
+ * Stream readers take whatever is there, up to their maximum.
+ */
+UTIL_UNSAFE
+static void queue_timeout_read( thd_cblk_t *p_thd )
+{
+	queue_cblk_t *p_q;
+	queue_schinfo_read_t *p_readinfo;
+
+	p_q = UTIL_CONTAINER_OF( p_thd->item_sch.p_q, queue_cblk_t, q_wait_read );
+	p_readinfo = p_thd->p_schinfo;
+
+	QUEUE_STATS_WAKE( p_q, p_readinfo, &g_sch );
+#if OSPORT_QUEUE_STATS
+	p_q->stats.num_timeouts++;
+#endif
+
+	if( p_readinfo->flag & QUEUE_READ_STREAM )
+	{
+		/* off the wait list first, so it is not served below */
+		sch_qitem_remove( &p_thd->item_sch );
+
+		queue_serve_stream( p_q, p_readinfo );
+		p_readinfo->result = true;
+
+		/* acquired data holds its space until released */
+		if( (p_readinfo->size != 0) && !(p_readinfo->flag & QUEUE_READ_ACQUIRE) )
+			queue_unlock_threads( p_q, &g_sch );
+	}
+}
+
+/*
+ * Block the current thread until it can write, returns the wait result.
+ * The queue may be gone once woken, the waker or the timeout handler
+ * keeps the statistics.
+ */
+UTIL_UNSAFE
+static bool_t queue_block_write( queue_cblk_t *p_q, queue_schinfo_write_t *p_schinfo, uint_t timeout )
+{
+#if OSPORT_QUEUE_STATS
+	p_q->stats.num_blocked_sends++;
+#endif
+
+	thd_block_current_cb( &p_q->q_wait_write, p_schinfo, timeout, queue_timeout_write, &g_sch );
+
+	return p_schinfo->result;
+}
+
+/*
+ * Block the current thread until it can read, returns the wait result.
+ * The queue may be gone once woken, the waker or the timeout handler
+ * keeps the statistics.
+ */
+UTIL_UNSAFE
+static bool_t queue_block_read( queue_cblk_t *p_q, queue_schinfo_read_t *p_schinfo, uint_t timeout )
+{
+#if OSPORT_QUEUE_STATS
+	p_q->stats.num_blocked_receives++;
+#endif
+
+	thd_block_current_cb( &p_q->q_wait_read, p_schinfo, timeout, queue_timeout_read, &g_sch );
+
+	return p_schinfo->result;
+}
+
 UTIL_SAFE
 os_handle_t os_queue_create(os_uint_t size)
 {
-	queue_cblk_t *p_q;
-	byte_t *p_buffer;
+	queue_cblk_t *p_q = NULL;
+	byte_t *p_buffer = NULL;
 
-	UTIL_LOCK_EVERYTHING();
-	p_q = mpool_alloc( sizeof(p_q), &g_mpool, &g_mlst );
+	if( mpool_lock( &g_mpool, &g_sch ) )
+	{
+		p_q = mpool_alloc( sizeof(queue_cblk_t), &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+		if( p_q != NULL )
+		{
+			p_buffer = mpool_alloc( size, &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+			if( p_buffer == NULL )
+			{
+				mpool_free(p_q, &g_mpool);
+				p_q = NULL;
+			}
+			else
+			{
+				MPOOL_TAG( p_q, OSPORT_CALLER_ADDRESS() );
+				MPOOL_TAG( p_buffer, OSPORT_CALLER_ADDRESS() );
+			}
+		}
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
 
 	if( p_q != NULL )
 	{
-		p_buffer = mpool_alloc( size, &g_mpool, &g_mlst );
-
-		if( p_buffer == NULL )
-			mpool_free(p_q, &g_mpool);
-		else
-			queue_init( p_q, p_buffer, size);
+		UTIL_LOCK_EVERYTHING();
+		queue_init( p_q, p_buffer, size);
+		UTIL_UNLOCK_EVERYTHING();
 	}
-	UTIL_UNLOCK_EVERYTHING();
 
 	return (os_handle_t)p_q;
 }
@@ -470,39 +1143,470 @@ void os_queue_delete(os_handle_t h_q)
 	UTIL_ASSERT(p_q != NULL);
 
 	UTIL_LOCK_EVERYTHING();
-
 	queue_delete_static(p_q, &g_sch);
+	UTIL_UNLOCK_EVERYTHING();
 
 	/* free memory */
-	mpool_free( p_q, &g_mpool );
+	mpool_lock_free( p_q->p_buffer, &g_mpool, &g_sch );
+	mpool_lock_free( p_q, &g_mpool, &g_sch );
+}
+
+UTIL_SAFE
+void os_queue_reset(os_handle_t h_q)
+{
+	queue_cblk_t *p_q;
+
+	p_q = (queue_cblk_t*)h_q;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT(p_q != NULL);
+
+	/* discard published data, reserved and acquired spans stay valid */
+	UTIL_LOCK_EVERYTHING();
+	p_q->acquire = p_q->write;
+	if( p_q->num_acquired == 0 )
+		p_q->read = p_q->write;
+	queue_unlock_threads(p_q, &g_sch);
 	UTIL_UNLOCK_EVERYTHING();
 }
 
 UTIL_SAFE
-void os_queue_reset(os_handle_t h_q)
+void os_queue_set_policy(os_handle_t h_q, os_queue_policy_t policy)
+{
+	queue_cblk_t *p_q;
+
+	p_q = (queue_cblk_t*)h_q;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q, or unknown policy
+	 */
+	UTIL_ASSERT(p_q != NULL);
+	UTIL_ASSERT((policy == OS_QUEUE_POLICY_HEAD_OF_LINE) ||
+			(policy == OS_QUEUE_POLICY_FIRST_FIT));
+
+	/* waiters behind the head may fit now */
+	UTIL_LOCK_EVERYTHING();
+	if( policy == OS_QUEUE_POLICY_FIRST_FIT )
+		p_q->policy = QUEUE_POLICY_FIRST_FIT;
+	else
+		p_q->policy = QUEUE_POLICY_HEAD_OF_LINE;
+	queue_unlock_threads(p_q, &g_sch);
+	UTIL_UNLOCK_EVERYTHING();
+}
+
+UTIL_SAFE
+os_uint_t os_queue_get_size(os_handle_t h_q)
+{
+	queue_cblk_t *p_q;
+	uint_t ret;
+	p_q = (queue_cblk_t*)h_q;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT(p_q != NULL);
+
+	UTIL_LOCK_EVERYTHING();
+	ret = p_q->size;
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+UTIL_SAFE
+os_uint_t os_queue_get_used_size(os_handle_t h_q)
+{
+	queue_cblk_t *p_q;
+	uint_t ret;
+	p_q = (queue_cblk_t*)h_q;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT(p_q != NULL);
+
+	UTIL_LOCK_EVERYTHING();
+	ret = queue_get_used_size(p_q);
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+UTIL_SAFE
+os_uint_t os_queue_get_free_size(os_handle_t h_q)
+{
+	queue_cblk_t *p_q;
+	uint_t ret;
+
+	p_q = (queue_cblk_t*)h_q;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT(p_q != NULL);
+
+	UTIL_LOCK_EVERYTHING();
+	ret = queue_get_free_size(p_q);
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
+
+UTIL_SAFE
+void os_queue_get_stats(os_handle_t h_q, os_queue_stats_t *p_stats)
+{
+	queue_cblk_t *p_q;
+	p_q = (queue_cblk_t*)h_q;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q or p_stats
+	 */
+	UTIL_ASSERT(p_q != NULL);
+	UTIL_ASSERT(p_stats != NULL);
+
+	UTIL_LOCK_EVERYTHING();
+#if OSPORT_QUEUE_STATS
+	p_stats->max_used_size = p_q->stats.max_used;
+	p_stats->bytes_in = p_q->stats.bytes_in;
+	p_stats->bytes_out = p_q->stats.bytes_out;
+	p_stats->num_blocked_sends = p_q->stats.num_blocked_sends;
+	p_stats->num_blocked_receives = p_q->stats.num_blocked_receives;
+	p_stats->blocked_time = p_q->stats.blocked_time;
+	p_stats->num_timeouts = p_q->stats.num_timeouts;
+#else
+	(void)p_q;
+	p_stats->max_used_size = 0;
+	p_stats->bytes_in = 0;
+	p_stats->bytes_out = 0;
+	p_stats->num_blocked_sends = 0;
+	p_stats->num_blocked_receives = 0;
+	p_stats->blocked_time = 0;
+	p_stats->num_timeouts = 0;
+#endif
+	UTIL_UNLOCK_EVERYTHING();
+}
+
+UTIL_SAFE
+os_bool_t os_queue_peek(os_handle_t h_q, void *p_data, os_uint_t size,
+		os_uint_t timeout)
+{
+	queue_cblk_t *p_q;
+	os_bool_t ret;
+	queue_schinfo_read_t schinfo;
+	p_q = (queue_cblk_t*)h_q;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT(p_q != NULL);
+
+	UTIL_LOCK_EVERYTHING();
+	if( queue_get_used_size(p_q) >= size )
+	{
+		if( p_data != NULL )
+			queue_peek(p_q, p_data, size );
+
+		ret = true;
+	}
+	else
+	{
+		queue_schinfo_read_init( &schinfo, QUEUE_READ_PEEK );
+		schinfo.p_data = p_data;
+		schinfo.size = size;
+		ret = queue_block_read( p_q, &schinfo, timeout );
+	}
+
+	UTIL_UNLOCK_EVERYTHING();
+	return ret;
+}
+
+UTIL_SAFE
+os_bool_t os_queue_peek_nb(os_handle_t h_q, void *p_data, os_uint_t size)
+{
+	queue_cblk_t *p_q;
+	os_bool_t ret = false;
+	p_q = (queue_cblk_t*)h_q;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT(p_q != NULL);
+
+	UTIL_LOCK_EVERYTHING();
+	if( queue_get_used_size(p_q) >= size )
+	{
+		if( p_data != NULL)
+			queue_peek(p_q, p_data, size );
+		ret = true;
+	}
+
+	UTIL_UNLOCK_EVERYTHING();
+	return ret;
+}
+
+/*
+ * Copy caller data into a reserved span
+ */
+UTIL_SAFE
+static void queue_span_copy_in( const queue_span_t *p_span, const byte_t *p_data )
+{
+	util_copy( p_span->p_data[0], p_data, p_span->size[0] );
+	util_copy( p_span->p_data[1], p_data + p_span->size[0], p_span->size[1] );
+}
+
+/*
+ * Copy an acquired span out to the caller
+ */
+UTIL_SAFE
+static void queue_span_copy_out( const queue_span_t *p_span, byte_t *p_data )
+{
+	util_copy( p_data, p_span->p_data[0], p_span->size[0] );
+	util_copy( p_data + p_span->size[0], p_span->p_data[1], p_span->size[1] );
+}
+
+/*
+ * Copy caller segments into a reserved span
+ */
+UTIL_SAFE
+static void queue_span_copy_in_v( const queue_span_t *p_span, const queue_seg_t *p_seg, uint_t num )
+{
+	uint_t i, part = 0, offset = 0, size, copy;
+	const byte_t *p_data;
+
+	for( i = 0; i < num; i++ )
+	{
+		p_data = p_seg[i].p_data;
+		size = p_seg[i].size;
+
+		while( size != 0 )
+		{
+			copy = p_span->size[part] - offset;
+			if( copy > size )
+				copy = size;
+
+			util_copy( p_span->p_data[part] + offset, p_data, copy );
+			p_data += copy;
+			size -= copy;
+			offset += copy;
+
+			/* on to the part after the wrap */
+			if( offset == p_span->size[part] )
+			{
+				part++;
+				offset = 0;
+			}
+		}
+	}
+}
+
+/*
+ * Copy an acquired span out to caller segments
+ */
+UTIL_SAFE
+static void queue_span_copy_out_v( const queue_span_t *p_span, const queue_seg_t *p_seg, uint_t num )
+{
+	uint_t i, part = 0, offset = 0, size, copy;
+	byte_t *p_data;
+
+	for( i = 0; i < num; i++ )
+	{
+		p_data = p_seg[i].p_data;
+		size = p_seg[i].size;
+
+		while( size != 0 )
+		{
+			copy = p_span->size[part] - offset;
+			if( copy > size )
+				copy = size;
+
+			util_copy( p_data, p_span->p_data[part] + offset, copy );
+			p_data += copy;
+			size -= copy;
+			offset += copy;
+
+			/* on to the part after the wrap */
+			if( offset == p_span->size[part] )
+			{
+				part++;
+				offset = 0;
+			}
+		}
+	}
+}
+
+/*
+ * Send data, messages larger than OSPORT_QUEUE_LOCKED_COPY_MAX are
+ * copied with interrupts enabled into space reserved under the lock,
+ * and published when committed
+ */
+UTIL_SAFE
+static os_bool_t queue_send( queue_cblk_t *p_q, const byte_t *p_data, uint_t size,
+		bool_t block, os_uint_t timeout )
+{
+	os_bool_t ret = false;
+	bool_t reserved = false;
+	queue_schinfo_write_t schinfo;
+	queue_span_t span;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT( p_q != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	if( queue_get_free_size(p_q) >= size )
+	{
+		if( size > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_reserve( p_q, size, &span );
+			reserved = true;
+		}
+		else
+		{
+			queue_write_handoff( p_q, p_data, size, &g_sch );
+			queue_unlock_threads( p_q, &g_sch );
+		}
+		ret = true;
+	}
+	else if( block )
+	{
+		if( size > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_schnifo_write_init( &schinfo, QUEUE_WRITE_RESERVE );
+			schinfo.p_data = NULL;
+			schinfo.p_span = &span;
+		}
+		else
+		{
+			queue_schnifo_write_init( &schinfo, 0 );
+			schinfo.p_data = p_data;
+		}
+
+		schinfo.size = size;
+		ret = queue_block_write( p_q, &schinfo, timeout );
+		reserved = ret && (schinfo.flag & QUEUE_WRITE_RESERVE);
+	}
+	UTIL_UNLOCK_EVERYTHING();
+
+	if( reserved )
+	{
+		queue_span_copy_in( &span, p_data );
+
+		UTIL_LOCK_EVERYTHING();
+		if( queue_commit(p_q) )
+			queue_unlock_threads( p_q, &g_sch );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return ret;
+}
+
+/*
+ * Receive data, messages larger than OSPORT_QUEUE_LOCKED_COPY_MAX are
+ * acquired under the lock, copied with interrupts enabled, and their
+ * space freed when released
+ */
+UTIL_SAFE
+static os_bool_t queue_receive( queue_cblk_t *p_q, byte_t *p_data, uint_t size,
+		bool_t block, os_uint_t timeout )
+{
+	os_bool_t ret = false;
+	bool_t acquired = false;
+	queue_schinfo_read_t schinfo;
+	queue_span_t span;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_q
+	 */
+	UTIL_ASSERT( p_q != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	if( queue_get_used_size(p_q) >= size )
+	{
+		if( size > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_acquire( p_q, size, &span );
+			acquired = true;
+		}
+		else
+		{
+			queue_read( p_q, p_data, size );
+			queue_unlock_threads( p_q, &g_sch );
+		}
+		ret = true;
+	}
+	else if( (size <= OSPORT_QUEUE_LOCKED_COPY_MAX) &&
+			queue_read_handoff(p_q, p_data, size, &g_sch ) )
+	{
+		queue_unlock_threads( p_q, &g_sch );
+		ret = true;
+	}
+	else if( block )
+	{
+		if( size > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_schinfo_read_init( &schinfo, QUEUE_READ_ACQUIRE );
+			schinfo.p_data = NULL;
+			schinfo.p_span = &span;
+		}
+		else
+		{
+			queue_schinfo_read_init( &schinfo, 0 );
+			schinfo.p_data = p_data;
+		}
+
+		schinfo.size = size;
+		ret = queue_block_read( p_q, &schinfo, timeout );
+		acquired = ret && (schinfo.flag & QUEUE_READ_ACQUIRE);
+	}
+	UTIL_UNLOCK_EVERYTHING();
+
+	if( acquired )
+	{
+		queue_span_copy_out( &span, p_data );
+
+		UTIL_LOCK_EVERYTHING();
+		if( queue_release(p_q) )
+			queue_unlock_threads( p_q, &g_sch );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return ret;
+}
+
+UTIL_SAFE
+os_bool_t os_queue_send(os_handle_t h_q, const void *p_data, os_uint_t size,
+		os_uint_t timeout)
+{
+	return queue_send( (queue_cblk_t*)h_q, p_data, size, true, timeout );
+}
+
+UTIL_SAFE
+os_bool_t os_queue_send_nb(os_handle_t h_q, const void *p_data,
+		os_uint_t size)
 {
-	queue_cblk_t *p_q;
-
-	p_q = (queue_cblk_t*)h_q;
-
-	/*
-	 * If failed:
-	 * NULL pointer passed to p_q
-	 */
-	UTIL_ASSERT(p_q != NULL);
-
-	UTIL_LOCK_EVERYTHING();
-	p_q->read = 0;
-	p_q->write = 0;
-	queue_unlock_threads(p_q, &g_sch);
-	UTIL_UNLOCK_EVERYTHING();
+	return queue_send( (queue_cblk_t*)h_q, p_data, size, false, 0 );
 }
 
 UTIL_SAFE
-os_uint_t os_queue_get_size(os_handle_t h_q)
+os_bool_t os_queue_send_ahead(os_handle_t h_q, const void *p_data, os_uint_t size,
+		os_uint_t timeout)
 {
 	queue_cblk_t *p_q;
-	uint_t ret;
+	os_bool_t ret;
+	queue_schinfo_write_t schinfo;
 	p_q = (queue_cblk_t*)h_q;
 
 	/*
@@ -512,17 +1616,30 @@ os_uint_t os_queue_get_size(os_handle_t h_q)
 	UTIL_ASSERT(p_q != NULL);
 
 	UTIL_LOCK_EVERYTHING();
-	ret = p_q->size;
-	UTIL_UNLOCK_EVERYTHING();
+	if( queue_get_ahead_size(p_q) >= size )
+	{
+		queue_write_ahead(p_q, p_data, size );
+		queue_unlock_threads( p_q, &g_sch );
+		ret = true;
+	}
+	else
+	{
+		queue_schnifo_write_init( &schinfo, QUEUE_WRITE_AHEAD );
+		schinfo.p_data = p_data;
+		schinfo.size = size;
+		ret = queue_block_write( p_q, &schinfo, timeout );
+	}
 
+	UTIL_UNLOCK_EVERYTHING();
 	return ret;
 }
 
 UTIL_SAFE
-os_uint_t os_queue_get_used_size(os_handle_t h_q)
+os_bool_t os_queue_send_ahead_nb(os_handle_t h_q, const void *p_data,
+		os_uint_t size)
 {
 	queue_cblk_t *p_q;
-	uint_t ret;
+	os_bool_t ret = false;
 	p_q = (queue_cblk_t*)h_q;
 
 	/*
@@ -532,273 +1649,470 @@ os_uint_t os_queue_get_used_size(os_handle_t h_q)
 	UTIL_ASSERT(p_q != NULL);
 
 	UTIL_LOCK_EVERYTHING();
-	ret = queue_get_used_size(p_q);
+	if( queue_get_ahead_size(p_q) >= size )
+	{
+		queue_write_ahead(p_q, p_data, size );
+		queue_unlock_threads( p_q, &g_sch );
+		ret = true;
+	}
 	UTIL_UNLOCK_EVERYTHING();
-
 	return ret;
 }
 
 UTIL_SAFE
-os_uint_t os_queue_get_free_size(os_handle_t h_q)
+os_bool_t os_queue_receive(os_handle_t h_q, void *p_data, os_uint_t size,
+		os_uint_t timeout)
 {
-	queue_cblk_t *p_q;
-	uint_t ret;
-
-	p_q = (queue_cblk_t*)h_q;
-
-	/*
-	 * If failed:
-	 * NULL pointer passed to p_q
-	 */
-	UTIL_ASSERT(p_q != NULL);
-
-	UTIL_LOCK_EVERYTHING();
-	ret = queue_get_free_size(p_q);
-	UTIL_UNLOCK_EVERYTHING();
+	return queue_receive( (queue_cblk_t*)h_q, p_data, size, true, timeout );
+}
 
-	return ret;
+UTIL_SAFE
+os_bool_t os_queue_receive_nb(os_handle_t h_q, void *p_data, os_uint_t size)
+{
+	return queue_receive( (queue_cblk_t*)h_q, p_data, size, false, 0 );
 }
 
 UTIL_SAFE
-os_bool_t os_queue_peek(os_handle_t h_q, void *p_data, os_uint_t size,
-		os_uint_t timeout)
+os_uint_t os_queue_receive_stream(os_handle_t h_q, void *p_data, os_uint_t trigger,
+		os_uint_t max, os_uint_t timeout)
 {
 	queue_cblk_t *p_q;
-	os_bool_t ret;
+	uint_t ret;
+	bool_t acquired = false;
 	queue_schinfo_read_t schinfo;
+	queue_span_t span;
 	p_q = (queue_cblk_t*)h_q;
 
 	/*
 	 * If failed:
-	 * NULL pointer passed to p_q
+	 * NULL pointer passed to p_q or p_data, or trigger above max
 	 */
 	UTIL_ASSERT(p_q != NULL);
+	UTIL_ASSERT(p_data != NULL);
+	UTIL_ASSERT(trigger <= max);
 
 	UTIL_LOCK_EVERYTHING();
-	if( queue_get_used_size(p_q) >= size )
+	if( queue_get_used_size(p_q) < trigger )
 	{
-		if( p_data != NULL )
-			queue_peek(p_q, p_data, size );
+		/*
+		 * woken once the trigger level is met, not per byte, a timeout
+		 * takes whatever is there, see queue_timeout_read
+		 */
+		if( max > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_schinfo_read_init( &schinfo, QUEUE_READ_STREAM | QUEUE_READ_ACQUIRE );
+			schinfo.p_data = NULL;
+			schinfo.p_span = &span;
+		}
+		else
+		{
+			queue_schinfo_read_init( &schinfo, QUEUE_READ_STREAM );
+			schinfo.p_data = p_data;
+		}
 
-		ret = true;
+		schinfo.size = trigger;
+		schinfo.max = max;
+
+		/* the queue may be gone if the wait failed */
+		if( queue_block_read( p_q, &schinfo, timeout ) )
+		{
+			ret = schinfo.size;
+			acquired = (schinfo.flag & QUEUE_READ_ACQUIRE);
+		}
+		else
+			ret = 0;
 	}
 	else
 	{
-		queue_schinfo_read_init( &schinfo, QUEUE_READ_PEEK );
-		schinfo.p_data = p_data;
-		schinfo.size = size;
-		thd_block_current(&p_q->q_wait_read, &schinfo, timeout, &g_sch );
-		ret = schinfo.result;
-	}
+		/* trigger met already */
+		ret = queue_get_used_size(p_q);
+		if( ret > max )
+			ret = max;
 
+		if( ret > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_acquire( p_q, ret, &span );
+			acquired = true;
+		}
+		else if( ret != 0 )
+		{
+			queue_read(p_q, p_data, ret );
+			queue_unlock_threads( p_q, &g_sch );
+		}
+	}
 	UTIL_UNLOCK_EVERYTHING();
+
+	if( acquired )
+	{
+		queue_span_copy_out( &span, p_data );
+
+		UTIL_LOCK_EVERYTHING();
+		if( queue_release(p_q) )
+			queue_unlock_threads( p_q, &g_sch );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
 	return ret;
 }
 
+/*
+ * Send segments as one message, messages larger than
+ * OSPORT_QUEUE_LOCKED_COPY_MAX are copied with interrupts enabled
+ * into space reserved under the lock, as queue_send does
+ */
 UTIL_SAFE
-os_bool_t os_queue_peek_nb(os_handle_t h_q, void *p_data, os_uint_t size)
+static os_bool_t queue_sendv( queue_cblk_t *p_q, const queue_seg_t *p_seg, uint_t num,
+		bool_t block, os_uint_t timeout )
 {
-	queue_cblk_t *p_q;
 	os_bool_t ret = false;
-	p_q = (queue_cblk_t*)h_q;
+	bool_t reserved = false;
+	queue_schinfo_write_t schinfo;
+	queue_span_t span;
+	uint_t size;
 
 	/*
 	 * If failed:
 	 * NULL pointer passed to p_q
 	 */
-	UTIL_ASSERT(p_q != NULL);
+	UTIL_ASSERT( p_q != NULL );
 
+	size = queue_get_seg_size( p_seg, num );
+
+	/* all segments in one go, readers see a single message */
 	UTIL_LOCK_EVERYTHING();
-	if( queue_get_used_size(p_q) >= size )
+	if( queue_get_free_size(p_q) >= size )
 	{
-		if( p_data != NULL)
-			queue_peek(p_q, p_data, size );
+		if( size > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_reserve( p_q, size, &span );
+			reserved = true;
+		}
+		else
+		{
+			queue_writev( p_q, p_seg, num );
+			queue_unlock_threads( p_q, &g_sch );
+		}
 		ret = true;
 	}
+	else if( block )
+	{
+		if( size > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_schnifo_write_init( &schinfo, QUEUE_WRITE_RESERVE );
+			schinfo.p_span = &span;
+		}
+		else
+		{
+			queue_schnifo_write_init( &schinfo, QUEUE_WRITE_VECTOR );
+			schinfo.p_seg = p_seg;
+			schinfo.num_seg = num;
+		}
 
+		schinfo.p_data = NULL;
+		schinfo.size = size;
+		ret = queue_block_write( p_q, &schinfo, timeout );
+		reserved = ret && (schinfo.flag & QUEUE_WRITE_RESERVE);
+	}
 	UTIL_UNLOCK_EVERYTHING();
+
+	if( reserved )
+	{
+		queue_span_copy_in_v( &span, p_seg, num );
+
+		UTIL_LOCK_EVERYTHING();
+		if( queue_commit(p_q) )
+			queue_unlock_threads( p_q, &g_sch );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
 	return ret;
 }
 
+/*
+ * Receive one message into segments, messages larger than
+ * OSPORT_QUEUE_LOCKED_COPY_MAX are acquired under the lock and
+ * copied with interrupts enabled, as queue_receive does
+ */
 UTIL_SAFE
-os_bool_t os_queue_send(os_handle_t h_q, const void *p_data, os_uint_t size,
-		os_uint_t timeout)
+static os_bool_t queue_receivev( queue_cblk_t *p_q, const queue_seg_t *p_seg, uint_t num,
+		bool_t block, os_uint_t timeout )
 {
-	queue_cblk_t *p_q;
-	os_bool_t ret;
-	queue_schinfo_write_t schinfo;
-	p_q = (queue_cblk_t*)h_q;
+	os_bool_t ret = false;
+	bool_t acquired = false;
+	queue_schinfo_read_t schinfo;
+	queue_span_t span;
+	uint_t size;
 
 	/*
 	 * If failed:
 	 * NULL pointer passed to p_q
 	 */
-	UTIL_ASSERT(p_q != NULL);
+	UTIL_ASSERT( p_q != NULL );
+
+	size = queue_get_seg_size( p_seg, num );
 
 	UTIL_LOCK_EVERYTHING();
-	if( queue_get_free_size(p_q) >= size )
+	if( queue_get_used_size(p_q) >= size )
 	{
-		queue_write(p_q, p_data, size );
-		queue_unlock_threads( p_q, &g_sch );
+		if( size > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_acquire( p_q, size, &span );
+			acquired = true;
+		}
+		else
+		{
+			queue_readv( p_q, p_seg, num );
+			queue_unlock_threads( p_q, &g_sch );
+		}
 		ret = true;
 	}
-	else
+	else if( block )
 	{
-		queue_schnifo_write_init( &schinfo, 0 );
-		schinfo.p_data = p_data;
+		if( size > OSPORT_QUEUE_LOCKED_COPY_MAX )
+		{
+			queue_schinfo_read_init( &schinfo, QUEUE_READ_ACQUIRE );
+			schinfo.p_span = &span;
+		}
+		else
+		{
+			queue_schinfo_read_init( &schinfo, QUEUE_READ_VECTOR );
+			schinfo.p_seg = p_seg;
+			schinfo.num_seg = num;
+		}
+
+		schinfo.p_data = NULL;
 		schinfo.size = size;
-		thd_block_current(&p_q->q_wait_write, &schinfo, timeout, &g_sch );
-		ret = schinfo.result;
+		ret = queue_block_read( p_q, &schinfo, timeout );
+		acquired = ret && (schinfo.flag & QUEUE_READ_ACQUIRE);
 	}
-
 	UTIL_UNLOCK_EVERYTHING();
+
+	if( acquired )
+	{
+		queue_span_copy_out_v( &span, p_seg, num );
+
+		UTIL_LOCK_EVERYTHING();
+		if( queue_release(p_q) )
+			queue_unlock_threads( p_q, &g_sch );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
 	return ret;
 }
 
 UTIL_SAFE
-os_bool_t os_queue_send_nb(os_handle_t h_q, const void *p_data,
-		os_uint_t size)
+os_bool_t os_queue_sendv(os_handle_t h_q, const os_queue_seg_t *p_segs,
+		os_uint_t num, os_uint_t timeout)
 {
-	queue_cblk_t *p_q;
-	os_bool_t ret = false;
-	p_q = (queue_cblk_t*)h_q;
+	return queue_sendv( (queue_cblk_t*)h_q, (const queue_seg_t*)p_segs, num, true, timeout );
+}
 
-	/*
-	 * If failed:
-	 * NULL pointer passed to p_q
-	 */
-	UTIL_ASSERT(p_q != NULL);
+UTIL_SAFE
+os_bool_t os_queue_sendv_nb(os_handle_t h_q, const os_queue_seg_t *p_segs,
+		os_uint_t num)
+{
+	return queue_sendv( (queue_cblk_t*)h_q, (const queue_seg_t*)p_segs, num, false, 0 );
+}
 
-	UTIL_LOCK_EVERYTHING();
-	if( queue_get_free_size(p_q) >= size )
+UTIL_SAFE
+os_bool_t os_queue_receivev(os_handle_t h_q, const os_queue_seg_t *p_segs,
+		os_uint_t num, os_uint_t timeout)
+{
+	return queue_receivev( (queue_cblk_t*)h_q, (const queue_seg_t*)p_segs, num, true, timeout );
+}
+
+UTIL_SAFE
+os_bool_t os_queue_receivev_nb(os_handle_t h_q, const os_queue_seg_t *p_segs,
+		os_uint_t num)
+{
+	return queue_receivev( (queue_cblk_t*)h_q, (const queue_seg_t*)p_segs, num, false, 0 );
+}
+
+/*
+ * Copy a buffer span to the caller
+ */
+UTIL_SAFE
+static void queue_span_export( const queue_span_t *p_span, os_queue_span_t *p_to )
+{
+	p_to->p_data[0] = p_span->p_data[0];
+	p_to->size[0] = p_span->size[0];
+	p_to->p_data[1] = p_span->p_data[1];
+	p_to->size[1] = p_span->size[1];
+}
+
+/*
+ * Check that a caller span lies in the outstanding part of the
+ * buffer, from an index up to another
+ */
+UTIL_UNSAFE
+static bool_t queue_span_outstanding( const queue_cblk_t *p_q, uint_t from, uint_t to,
+		const os_queue_span_t *p_span )
+{
+	handle_t offset;
+	uint_t index, window;
+	bool_t ret = false;
+
+	/* size of the outstanding part */
+	if( to >= from )
+		window = to - from;
+	else
+		window = p_q->size - from + to;
+
+	offset = (handle_t)p_span->p_data[0] - (handle_t)p_q->p_buffer;
+
+	if( ((handle_t)p_span->p_data[0] >= (handle_t)p_q->p_buffer) && (offset < p_q->size) )
 	{
-		queue_write(p_q, p_data, size );
-		queue_unlock_threads( p_q, &g_sch );
-		ret = true;
+		/* position of the span in the outstanding part */
+		index = (uint_t)offset;
+		if( index >= from )
+			index = index - from;
+		else
+			index = p_q->size - from + index;
+
+		ret = (index <= window) &&
+				(p_span->size[0] <= window - index) &&
+				(p_span->size[1] <= window - index - p_span->size[0]);
 	}
-	UTIL_UNLOCK_EVERYTHING();
+
 	return ret;
 }
 
 UTIL_SAFE
-os_bool_t os_queue_send_ahead(os_handle_t h_q, const void *p_data, os_uint_t size,
-		os_uint_t timeout)
+os_bool_t os_queue_send_reserve(os_handle_t h_q, os_uint_t size,
+		os_queue_span_t *p_span, os_uint_t timeout)
 {
 	queue_cblk_t *p_q;
 	os_bool_t ret;
 	queue_schinfo_write_t schinfo;
+	queue_span_t span;
 	p_q = (queue_cblk_t*)h_q;
 
 	/*
 	 * If failed:
-	 * NULL pointer passed to p_q
+	 * NULL pointer passed to p_q or p_span
 	 */
 	UTIL_ASSERT(p_q != NULL);
+	UTIL_ASSERT(p_span != NULL);
 
 	UTIL_LOCK_EVERYTHING();
 	if( queue_get_free_size(p_q) >= size )
 	{
-		queue_write_ahead(p_q, p_data, size );
-		queue_unlock_threads( p_q, &g_sch );
+		queue_reserve(p_q, size, &span );
 		ret = true;
 	}
 	else
 	{
-		queue_schnifo_write_init( &schinfo, QUEUE_WRITE_AHEAD );
-		schinfo.p_data = p_data;
+		queue_schnifo_write_init( &schinfo, QUEUE_WRITE_RESERVE );
+		schinfo.p_data = NULL;
 		schinfo.size = size;
-		thd_block_current(&p_q->q_wait_write, &schinfo, timeout, &g_sch );
-		ret = schinfo.result;
+		schinfo.p_span = &span;
+		ret = queue_block_write( p_q, &schinfo, timeout );
 	}
 
 	UTIL_UNLOCK_EVERYTHING();
+
+	if( ret )
+		queue_span_export( &span, p_span );
+
 	return ret;
 }
 
 UTIL_SAFE
-os_bool_t os_queue_send_ahead_nb(os_handle_t h_q, const void *p_data,
-		os_uint_t size)
+os_bool_t os_queue_send_commit(os_handle_t h_q, const os_queue_span_t *p_span)
 {
 	queue_cblk_t *p_q;
-	os_bool_t ret = false;
+	os_bool_t ret;
 	p_q = (queue_cblk_t*)h_q;
 
 	/*
 	 * If failed:
-	 * NULL pointer passed to p_q
+	 * NULL pointer passed to p_q or p_span
 	 */
 	UTIL_ASSERT(p_q != NULL);
+	UTIL_ASSERT(p_span != NULL);
 
 	UTIL_LOCK_EVERYTHING();
-	if( queue_get_free_size(p_q) >= size )
-	{
-		queue_write_ahead(p_q, p_data, size );
+	ret = queue_span_outstanding( p_q, p_q->write, p_q->reserve, p_span );
+
+	/*
+	 * If failed:
+	 * Span not reserved from this queue, or already committed
+	 */
+	UTIL_ASSERT( ret );
+
+	if( ret && queue_commit(p_q) )
 		queue_unlock_threads( p_q, &g_sch );
-		ret = true;
-	}
 	UTIL_UNLOCK_EVERYTHING();
+
 	return ret;
 }
 
 UTIL_SAFE
-os_bool_t os_queue_receive(os_handle_t h_q, void *p_data, os_uint_t size,
-		os_uint_t timeout)
+os_bool_t os_queue_receive_acquire(os_handle_t h_q, os_uint_t size,
+		os_queue_span_t *p_span, os_uint_t timeout)
 {
 	queue_cblk_t *p_q;
 	os_bool_t ret;
 	queue_schinfo_read_t schinfo;
+	queue_span_t span;
 	p_q = (queue_cblk_t*)h_q;
 
 	/*
 	 * If failed:
-	 * NULL pointer passed to p_q
+	 * NULL pointer passed to p_q or p_span
 	 */
 	UTIL_ASSERT(p_q != NULL);
+	UTIL_ASSERT(p_span != NULL);
 
 	UTIL_LOCK_EVERYTHING();
 	if( queue_get_used_size(p_q) >= size )
 	{
-		queue_read(p_q, p_data, size );
-		queue_unlock_threads( p_q, &g_sch );
+		queue_acquire(p_q, size, &span );
 		ret = true;
 	}
 	else
 	{
-		queue_schinfo_read_init( &schinfo, 0 );
-		schinfo.p_data = p_data;
+		queue_schinfo_read_init( &schinfo, QUEUE_READ_ACQUIRE );
+		schinfo.p_data = NULL;
 		schinfo.size = size;
-		thd_block_current(&p_q->q_wait_read, &schinfo, timeout, &g_sch );
-		ret = schinfo.result;
+		schinfo.p_span = &span;
+		ret = queue_block_read( p_q, &schinfo, timeout );
 	}
 
 	UTIL_UNLOCK_EVERYTHING();
+
+	if( ret )
+		queue_span_export( &span, p_span );
+
 	return ret;
 }
 
 UTIL_SAFE
-os_bool_t os_queue_receive_nb(os_handle_t h_q, void *p_data, os_uint_t size)
+os_bool_t os_queue_receive_release(os_handle_t h_q, const os_queue_span_t *p_span)
 {
 	queue_cblk_t *p_q;
-	os_bool_t ret = false;
+	os_bool_t ret;
 	p_q = (queue_cblk_t*)h_q;
 
 	/*
 	 * If failed:
-	 * NULL pointer passed to p_q
+	 * NULL pointer passed to p_q or p_span
 	 */
 	UTIL_ASSERT(p_q != NULL);
+	UTIL_ASSERT(p_span != NULL);
 
 	UTIL_LOCK_EVERYTHING();
-	if( queue_get_used_size(p_q) >= size )
-	{
-		queue_read(p_q, p_data, size );
-		queue_unlock_threads( p_q, &g_sch );
-		ret = true;
-	}
+	ret = queue_span_outstanding( p_q, p_q->read, p_q->acquire, p_span );
+
+	/*
+	 * If failed:
+	 * Span not acquired from this queue, or already released
+	 */
+	UTIL_ASSERT( ret );
 
+	if( ret && queue_release(p_q) )
+		queue_unlock_threads( p_q, &g_sch );
 	UTIL_UNLOCK_EVERYTHING();
+
 	return ret;
 }
-
-
-
@@ -0,0 +1,380 @@
+/** ************************************************************************
+ * @file ring.c
+ * @brief Single-producer, single-consumer byte ring
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#include "../include/ring.h"
+#include "../include/queue.h"
+#include "../include/global.h"
+#include "../include/api.h"
+
+/*
+ * Initialize ring
+ */
+UTIL_UNSAFE
+void ring_init( ring_cblk_t *p_ring, void *p_buffer, uint_t size )
+{
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_ring != NULL );
+	UTIL_ASSERT( size > 1 );
+
+	p_ring->p_buffer = (byte_t*)p_buffer;
+	p_ring->size = size;
+	p_ring->head = 0;
+	p_ring->tail = 0;
+	p_ring->level = 0;
+
+	sch_q_init( &p_ring->q_wait );
+}
+
+/*
+ * Delete a static ring
+ */
+UTIL_UNSAFE
+void ring_delete_static( ring_cblk_t *p_ring, sch_cblk_t *p_sch )
+{
+	sch_qitem_t *p_item;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_ring or p_sch
+	 */
+	UTIL_ASSERT( p_ring != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	/* ready the waiting consumer */
+	while( p_ring->q_wait.p_head != NULL )
+	{
+		p_item = p_ring->q_wait.p_head;
+
+		/*
+		 * If failed:
+		 * cannot obtain thread from item
+		 */
+		UTIL_ASSERT( p_item->p_thd != NULL );
+
+		thd_ready( p_item->p_thd, p_sch );
+	}
+
+	p_ring->level = 0;
+	sch_reschedule_req(p_sch);
+}
+
+/*
+ * Bytes written and not read yet, a snapshot that only grows
+ * for the consumer and only shrinks for the producer
+ */
+UTIL_SAFE
+uint_t ring_get_used_size( const ring_cblk_t *p_ring )
+{
+	uint_t head, tail;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_ring
+	 */
+	UTIL_ASSERT( p_ring != NULL );
+
+	head = p_ring->head;
+	tail = p_ring->tail;
+
+	if( head >= tail )
+		return head - tail;
+	else
+		return p_ring->size - tail + head;
+}
+
+/*
+ * Write as much as fits, only called by the producer.
+ * Data is copied before the head is published.
+ */
+UTIL_SAFE
+uint_t ring_write( ring_cblk_t *p_ring, const byte_t *p_data, uint_t size )
+{
+	uint_t head, first, space;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_ring != NULL );
+	UTIL_ASSERT( p_data != NULL );
+
+	head = p_ring->head;
+
+	/* one byte stays free to tell full from empty */
+	space = p_ring->size - 1 - ring_get_used_size( p_ring );
+	if( size > space )
+		size = space;
+
+	first = p_ring->size - head;
+	if( first > size )
+		first = size;
+
+	util_copy( p_ring->p_buffer + head, p_data, first );
+	util_copy( p_ring->p_buffer, p_data + first, size - first );
+
+	head += size;
+	if( head >= p_ring->size )
+		head -= p_ring->size;
+
+	OSPORT_MEMORY_BARRIER();
+	p_ring->head = head;
+
+	return size;
+}
+
+/*
+ * Read as much as available, only called by the consumer.
+ * Data is copied before the tail is published.
+ */
+UTIL_SAFE
+uint_t ring_read( ring_cblk_t *p_ring, byte_t *p_data, uint_t size )
+{
+	uint_t tail, first, used;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_ring != NULL );
+	UTIL_ASSERT( p_data != NULL );
+
+	tail = p_ring->tail;
+
+	used = ring_get_used_size( p_ring );
+	if( size > used )
+		size = used;
+
+	OSPORT_MEMORY_BARRIER();
+
+	first = p_ring->size - tail;
+	if( first > size )
+		first = size;
+
+	util_copy( p_data, p_ring->p_buffer + tail, first );
+	util_copy( p_data + first, p_ring->p_buffer, size - first );
+
+	tail += size;
+	if( tail >= p_ring->size )
+		tail -= p_ring->size;
+
+	OSPORT_MEMORY_BARRIER();
+	p_ring->tail = tail;
+
+	return size;
+}
+
+/*
+ * Wake the consumer when the awaited level is reached
+ */
+UTIL_UNSAFE
+void ring_notify( ring_cblk_t *p_ring, sch_cblk_t *p_sch )
+{
+	thd_cblk_t *p_thd;
+	queue_schinfo_read_t *p_readinfo;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_ring or p_sch
+	 */
+	UTIL_ASSERT( p_ring != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	if( (p_ring->level != 0) && (ring_get_used_size(p_ring) >= p_ring->level) &&
+		(p_ring->q_wait.p_head != NULL) )
+	{
+		/*
+		 * If failed:
+		 * cannot obtain thread
+		 */
+		UTIL_ASSERT( p_ring->q_wait.p_head->p_thd != NULL );
+		p_thd = p_ring->q_wait.p_head->p_thd;
+
+		/*
+		 * If failed:
+		 * read info missing
+		 */
+		UTIL_ASSERT( p_ring->q_wait.p_head->p_schinfo != NULL );
+		p_readinfo = p_ring->q_wait.p_head->p_schinfo;
+
+		p_ring->level = 0;
+		p_readinfo->result = true;
+		thd_ready( p_thd, p_sch );
+		sch_reschedule_req( p_sch );
+	}
+}
+
+/*
+ * Stop waiting for a level when the consumer times out
+ */
+UTIL_UNSAFE
+static void ring_timeout( thd_cblk_t *p_thd )
+{
+	ring_cblk_t *p_ring;
+
+	p_ring = UTIL_CONTAINER_OF( p_thd->item_sch.p_q, ring_cblk_t, q_wait );
+	p_ring->level = 0;
+}
+
+UTIL_SAFE
+os_handle_t os_ring_create( os_uint_t size )
+{
+	ring_cblk_t *p_ring = NULL;
+	byte_t *p_buffer = NULL;
+
+	if( mpool_lock( &g_mpool, &g_sch ) )
+	{
+		p_ring = mpool_alloc( sizeof(ring_cblk_t), &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+		if( p_ring != NULL )
+		{
+			p_buffer = mpool_alloc( size, &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+			if( p_buffer == NULL )
+			{
+				mpool_free( p_ring, &g_mpool );
+				p_ring = NULL;
+			}
+			else
+			{
+				MPOOL_TAG( p_ring, OSPORT_CALLER_ADDRESS() );
+				MPOOL_TAG( p_buffer, OSPORT_CALLER_ADDRESS() );
+			}
+		}
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	if( p_ring != NULL )
+	{
+		UTIL_LOCK_EVERYTHING();
+		ring_init( p_ring, p_buffer, size );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return (os_handle_t)p_ring;
+}
+
+UTIL_SAFE
+void os_ring_delete( os_handle_t h_ring )
+{
+	ring_cblk_t *p_ring;
+	p_ring = (ring_cblk_t*)h_ring;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_ring
+	 */
+	UTIL_ASSERT( p_ring != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	ring_delete_static( p_ring, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+
+	/* free memory */
+	mpool_lock_free( p_ring->p_buffer, &g_mpool, &g_sch );
+	mpool_lock_free( p_ring, &g_mpool, &g_sch );
+}
+
+UTIL_SAFE
+os_uint_t os_ring_get_used_size( os_handle_t h_ring )
+{
+	return ring_get_used_size( (ring_cblk_t*)h_ring );
+}
+
+/*
+ * The producer only takes the kernel lock when the consumer
+ * is waiting for a level
+ */
+UTIL_SAFE
+os_uint_t os_ring_write( os_handle_t h_ring, const void *p_data, os_uint_t size )
+{
+	ring_cblk_t *p_ring;
+	uint_t ret;
+	p_ring = (ring_cblk_t*)h_ring;
+
+	ret = ring_write( p_ring, p_data, size );
+
+	OSPORT_MEMORY_BARRIER();
+
+	if( p_ring->level != 0 )
+	{
+		UTIL_LOCK_EVERYTHING();
+		ring_notify( p_ring, &g_sch );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return ret;
+}
+
+UTIL_SAFE
+os_uint_t os_ring_read( os_handle_t h_ring, void *p_data, os_uint_t size )
+{
+	return ring_read( (ring_cblk_t*)h_ring, p_data, size );
+}
+
+UTIL_SAFE
+os_bool_t os_ring_wait( os_handle_t h_ring, os_uint_t level, os_uint_t timeout )
+{
+	ring_cblk_t *p_ring;
+	os_bool_t ret;
+	queue_schinfo_read_t schinfo;
+	p_ring = (ring_cblk_t*)h_ring;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_ring, invalid level,
+	 * or more than one consumer
+	 */
+	UTIL_ASSERT( p_ring != NULL );
+	UTIL_ASSERT( (level != 0) && (level < p_ring->size) );
+	UTIL_ASSERT( p_ring->q_wait.p_head == NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	if( ring_get_used_size(p_ring) >= level )
+		ret = true;
+	else
+	{
+		/* published before the producer can observe the ring again */
+		p_ring->level = level;
+
+		/*
+		 * level is cleared by the waker or on timeout, the ring
+		 * may be gone once the wait ends
+		 */
+		queue_schinfo_read_init( &schinfo, 0 );
+		schinfo.p_data = NULL;
+		schinfo.size = level;
+		thd_block_current_cb( &p_ring->q_wait, &schinfo, timeout, ring_timeout, &g_sch );
+		ret = schinfo.result;
+	}
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}
@@ -122,8 +122,8 @@ void sem_reset( sem_cblk_t *p_sem, uint_t counter, sch_cblk_t *p_sch )
 		 * If failed:
 		 * scheduling info missing
 		 */
-		UTIL_ASSERT( p_thd->p_schinfo != NULL );
-		p_schinfo = (sem_schinfo_t*)( p_thd->p_schinfo );
+		UTIL_ASSERT( p_sem->q_wait.p_head->p_schinfo != NULL );
+		p_schinfo = (sem_schinfo_t*)( p_sem->q_wait.p_head->p_schinfo );
 
 		/* check flags */
 		if( p_schinfo->wait_flag & SEM_PEEK )
@@ -157,16 +157,17 @@ os_handle_t os_semaphore_create( os_uint_t initial )
 {
 	sem_cblk_t *p_sem;
 
-	UTIL_LOCK_EVERYTHING();
-	p_sem = mpool_alloc( sizeof(sem_cblk_t), &g_mpool, &g_mlst );
+	p_sem = mpool_lock_alloc( sizeof(sem_cblk_t), &g_mpool, &g_mlst, MPOOL_TRANSIENT, &g_sch );
 
 	if( p_sem != NULL )
 	{
+		MPOOL_TAG( p_sem, OSPORT_CALLER_ADDRESS() );
+
+		UTIL_LOCK_EVERYTHING();
 		sem_init(p_sem, initial);
+		UTIL_UNLOCK_EVERYTHING();
 	}
 
-	UTIL_UNLOCK_EVERYTHING();
-
 	return (os_handle_t) p_sem;
 }
 
@@ -193,10 +194,10 @@ void os_semaphore_delete( os_handle_t h_sem )
 
 	UTIL_LOCK_EVERYTHING();
 	sem_delete_static(p_sem, &g_sch);
+	UTIL_UNLOCK_EVERYTHING();
 
 	/* free memory */
-	mpool_free( p_sem, &g_mpool );
-	UTIL_UNLOCK_EVERYTHING();
+	mpool_lock_free( p_sem, &g_mpool, &g_sch );
 }
 
 /**
@@ -57,6 +57,7 @@ void sch_qitem_init( sch_qitem_t *p_item, thd_cblk_t *p_thd, uint_t tag )
 	p_item->p_thd = p_thd;
 	p_item->p_q = NULL;
 	p_item->tag = tag;
+	p_item->p_schinfo = NULL;
 }
 
 /*
@@ -287,7 +288,11 @@ void sch_init( sch_cblk_t *p_sch )
 	sch_q_init( &p_sch->q_delay1);
 	sch_q_init( &p_sch->q_delay2 );
 
+	sch_q_init( &p_sch->q_zombie );
+
 	p_sch->lock_depth = 0;
+	p_sch->preempt_depth = 0;
+	p_sch->preempt_pending = false;
 	p_sch->timestamp = 0;
 	p_sch->p_current = NULL;
 	p_sch->p_next = NULL;
@@ -345,8 +350,6 @@ void sch_set_next_thread( sch_cblk_t *p_sch )
 UTIL_SAFE
 void sch_lock_int( sch_cblk_t *p_sch )
 {
-	uint_t int_depth;
-
 	/*
 	 * If failed:
 	 * Interrupt nested over 100 times, completely impossible.
@@ -354,13 +357,12 @@ void sch_lock_int( sch_cblk_t *p_sch )
 	 */
 	UTIL_ASSERT( p_sch->lock_depth < 100 );
 
-	int_depth = p_sch->lock_depth + 1;
-
-	if( int_depth == 1 )
+	if( p_sch->lock_depth == 0 )
 	{
 		OSPORT_DISABLE_INT();
-		p_sch->lock_depth = int_depth;
 	}
+
+	p_sch->lock_depth++;
 }
 
 /*
@@ -392,66 +394,126 @@ void sch_unlock_int( sch_cblk_t *p_sch )
 }
 
 /*
- * Reschedule threads, only sets next thread if has
- * a higher priority than current thread, will request
- * context switch if needed
+ * Lock preemption nested, interrupts stay enabled and
+ * rescheduling is postponed until unlocked
  */
-UTIL_UNSAFE
-void sch_reschedule_req( sch_cblk_t *p_sch )
+UTIL_SAFE
+void sch_lock_preempt( sch_cblk_t *p_sch )
 {
-	uint_t counter;
+	UTIL_LOCK_EVERYTHING();
 
 	/*
 	 * If failed:
-	 * NULL pointer passed to p_sch
+	 * Preemption locked over 100 times, completely impossible.
+	 * Underflow?
 	 */
-	UTIL_ASSERT( p_sch != NULL );
+	UTIL_ASSERT( p_sch->preempt_depth < 100 );
 
-	for( counter = 0; counter < OSPORT_NUM_PRIOS; counter++ )
-	{
-		if( p_sch->q_ready[counter].p_head != NULL )
-			break;
-	}
+	p_sch->preempt_depth++;
 
-	/*
-	 * If failed:
-	 * Idle thread missing
-	 */
-	UTIL_ASSERT( counter < OSPORT_NUM_PRIOS );
+	UTIL_UNLOCK_EVERYTHING();
+}
+
+/*
+ * Unlock preemption nested, performs the postponed reschedule
+ */
+UTIL_SAFE
+void sch_unlock_preempt( sch_cblk_t *p_sch )
+{
+	UTIL_LOCK_EVERYTHING();
 
 	/*
 	 * If failed:
-	 * Invalid current thread
+	 * Trying to release a lock you do not own
+	 * lock/unlock must be used in pairs
 	 */
-	UTIL_ASSERT( p_sch->p_current != NULL );
+	UTIL_ASSERT( p_sch->preempt_depth > 0 );
+
+	p_sch->preempt_depth--;
+
+	if( (p_sch->preempt_depth == 0) && p_sch->preempt_pending )
+	{
+		p_sch->preempt_pending = false;
+
+		/* current thread was blocked, suspended or deleted meanwhile */
+		if( p_sch->p_current->state != THD_STATE_READY )
+			sch_unload_current( p_sch );
+		else
+			sch_reschedule_req( p_sch );
+	}
+
+	UTIL_UNLOCK_EVERYTHING();
+}
+
+/*
+ * Reschedule threads, only sets next thread if has
+ * a higher priority than current thread, will request
+ * context switch if needed
+ */
+UTIL_UNSAFE
+void sch_reschedule_req( sch_cblk_t *p_sch )
+{
+	uint_t counter;
 
 	/*
 	 * If failed:
-	 * Invalid current thread priority
+	 * NULL pointer passed to p_sch
 	 */
-	UTIL_ASSERT( p_sch->p_current->item_sch.tag < OSPORT_NUM_PRIOS );
+	UTIL_ASSERT( p_sch != NULL );
 
-	if( counter < p_sch->p_current->item_sch.tag )
+	/* postponed until preemption is unlocked */
+	if( p_sch->preempt_depth != 0 )
 	{
+		p_sch->preempt_pending = true;
+	}
+	else
+	{
+		for( counter = 0; counter < OSPORT_NUM_PRIOS; counter++ )
+		{
+			if( p_sch->q_ready[counter].p_head != NULL )
+				break;
+		}
+
 		/*
 		 * If failed:
-		 * Cannot obtain thread from item
+		 * Idle thread missing
 		 */
-		UTIL_ASSERT( p_sch->q_ready[counter].p_head->p_thd != NULL );
+		UTIL_ASSERT( counter < OSPORT_NUM_PRIOS );
 
-		p_sch->p_next = p_sch->q_ready[counter].p_head->p_thd;
+		/*
+		 * If failed:
+		 * Invalid current thread
+		 */
+		UTIL_ASSERT( p_sch->p_current != NULL );
 
 		/*
 		 * If failed:
-		 * Broken link
+		 * Invalid current thread priority
 		 */
-		UTIL_ASSERT( p_sch->q_ready[counter].p_head->p_next != NULL);
+		UTIL_ASSERT( p_sch->p_current->item_sch.tag < OSPORT_NUM_PRIOS );
 
-		p_sch->q_ready[counter].p_head =
-				p_sch->q_ready[counter].p_head->p_next;
+		if( counter < p_sch->p_current->item_sch.tag )
+		{
+			/*
+			 * If failed:
+			 * Cannot obtain thread from item
+			 */
+			UTIL_ASSERT( p_sch->q_ready[counter].p_head->p_thd != NULL );
 
-		if( p_sch->p_current != p_sch->p_next )
-			OSPORT_CONTEXTSW_REQ();
+			p_sch->p_next = p_sch->q_ready[counter].p_head->p_thd;
+
+			/*
+			 * If failed:
+			 * Broken link
+			 */
+			UTIL_ASSERT( p_sch->q_ready[counter].p_head->p_next != NULL);
+
+			p_sch->q_ready[counter].p_head =
+					p_sch->q_ready[counter].p_head->p_next;
+
+			if( p_sch->p_current != p_sch->p_next )
+				OSPORT_CONTEXTSW_REQ();
+		}
 	}
 }
 
@@ -470,36 +532,44 @@ void sch_unload_current( sch_cblk_t *p_sch )
 	 */
 	UTIL_ASSERT( p_sch != NULL );
 
-	sch_set_next_thread(p_sch);
-
-	/*
-	 * when yielding, it is possible that current thread
-	 * still gets rescheduled. When this happens, only
-	 * generate context switch when switching to a different
-	 * thread
-	 */
-	if( p_sch->p_current != p_sch->p_next )
+	/* postponed until preemption is unlocked */
+	if( p_sch->preempt_depth != 0 )
 	{
+		p_sch->preempt_pending = true;
+	}
+	else
+	{
+		sch_set_next_thread(p_sch);
+
 		/*
-		 * If failed:
-		 * Invalid lock depth
+		 * when yielding, it is possible that current thread
+		 * still gets rescheduled. When this happens, only
+		 * generate context switch when switching to a different
+		 * thread
 		 */
-		UTIL_ASSERT( p_sch->lock_depth > 0);
+		if( p_sch->p_current != p_sch->p_next )
+		{
+			/*
+			 * If failed:
+			 * Invalid lock depth
+			 */
+			UTIL_ASSERT( p_sch->lock_depth > 0);
 
-		/* save lock depth locally */
-		lock_depth = p_sch->lock_depth;
-		p_sch->lock_depth = 0;
+			/* save lock depth locally */
+			lock_depth = p_sch->lock_depth;
+			p_sch->lock_depth = 0;
 
-		/* open a natural preemption point */
-		OSPORT_ENABLE_INT();
+			/* open a natural preemption point */
+			OSPORT_ENABLE_INT();
 
-		OSPORT_CONTEXTSW_REQ();
+			OSPORT_CONTEXTSW_REQ();
 
-		/* close the preemption point */
-		OSPORT_DISABLE_INT();
+			/* close the preemption point */
+			OSPORT_DISABLE_INT();
 
-		/* restore lock depth */
-		p_sch->lock_depth = lock_depth;
+			/* restore lock depth */
+			p_sch->lock_depth = lock_depth;
+		}
 	}
 }
 
@@ -562,16 +632,28 @@ void sch_handle_heartbeat( sch_cblk_t *p_sch )
 			/* obtain thread */
 			p_thd = p_item->p_thd;
 
+			/* still on the wait list, the object waited on is valid */
+			if( p_thd->p_timeout != NULL )
+				p_thd->p_timeout( p_thd );
+
 			thd_ready( p_thd, p_sch );
 		}
 		else
 			break;
 	}
 
-	sch_set_next_thread( p_sch );
+	/* round-robin postponed until preemption is unlocked */
+	if( p_sch->preempt_depth != 0 )
+	{
+		p_sch->preempt_pending = true;
+	}
+	else
+	{
+		sch_set_next_thread( p_sch );
 
-	if( p_sch->p_current != p_sch->p_next )
-		OSPORT_CONTEXTSW_REQ();
+		if( p_sch->p_current != p_sch->p_next )
+			OSPORT_CONTEXTSW_REQ();
+	}
 }
 
 /*
@@ -687,12 +769,34 @@ void thd_init( thd_cblk_t *p_thd, uint_t prio, void *p_stack, uint_t stack_size,
 	p_thd->p_sp = OSPORT_INIT_STACK(p_stack, stack_size, p_job, p_return );
 	p_thd->state = THD_STATE_READY;
 	p_thd->p_schinfo = NULL;
+	p_thd->p_timeout = NULL;
+	p_thd->p_wait_items = NULL;
+	p_thd->num_wait_items = 0;
 
 	sch_qitem_init( &p_thd->item_sch, p_thd, prio );
 	sch_qitem_init( &p_thd->item_delay, p_thd, 0 );
 	mlst_init( &p_thd->mlst );
 }
 
+/*
+ * Remove the extra wait items of a thread waiting on
+ * several objects from their wait queues
+ */
+UTIL_UNSAFE
+static void thd_remove_wait_items( thd_cblk_t *p_thd )
+{
+	uint_t i;
+
+	for( i = 0; i < p_thd->num_wait_items; i++ )
+	{
+		if( p_thd->p_wait_items[i].p_q != NULL )
+			sch_qitem_remove( &p_thd->p_wait_items[i] );
+	}
+
+	p_thd->p_wait_items = NULL;
+	p_thd->num_wait_items = 0;
+}
+
 /*
  * Ready a thread
  */
@@ -712,7 +816,10 @@ void thd_ready( thd_cblk_t *p_thd, sch_cblk_t *p_sch )
 	if( p_thd->item_delay.p_q != NULL )
 		sch_qitem_remove( &p_thd->item_delay );
 
+	thd_remove_wait_items( p_thd );
+
 	p_thd->p_schinfo = NULL;
+	p_thd->p_timeout = NULL;
 
 	/* change state to ready */
 	p_thd->state = THD_STATE_READY;
@@ -750,6 +857,12 @@ void thd_block_current( sch_qprio_t *p_to, void *p_schinfo, uint_t timeout,
 	UTIL_ASSERT( p_thd->item_sch.p_q != NULL );
 	UTIL_ASSERT( p_thd->item_delay.p_q == NULL );
 
+	/*
+	 * If failed:
+	 * Blocking with preemption locked
+	 */
+	UTIL_ASSERT( p_sch->preempt_depth == 0 );
+
 	p_thd->state = THD_STATE_BLOCKED;
 
 	/* remove from ready list */
@@ -757,6 +870,7 @@ void thd_block_current( sch_qprio_t *p_to, void *p_schinfo, uint_t timeout,
 
 	/* attach scheduling info */
 	p_thd->p_schinfo = p_schinfo;
+	p_thd->item_sch.p_schinfo = p_schinfo;
 
 	/* insert into resource list, if any */
 	if( p_to != NULL )
@@ -779,12 +893,39 @@ void thd_block_current( sch_qprio_t *p_to, void *p_schinfo, uint_t timeout,
 }
 
 /*
- * Create a thread using static memory
+ * Block current thread with a handler called if the wait times out.
+ * The handler runs in the heartbeat while the thread is still on the
+ * resource list, so the object waited on is valid. A thread woken any
+ * other way, including by deleting the object, must not touch it.
+ */
+UTIL_UNSAFE
+void thd_block_current_cb( sch_qprio_t *p_to, void *p_schinfo, uint_t timeout,
+		void (*p_timeout)(thd_cblk_t *p_thd), sch_cblk_t *p_sch )
+{
+	/*
+	 * If failed
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_sch != NULL );
+	UTIL_ASSERT( p_sch->p_current != NULL );
+
+	p_sch->p_current->p_timeout = p_timeout;
+	thd_block_current( p_to, p_schinfo, timeout, p_sch );
+}
+
+/*
+ * Create a thread using static memory. A deleted control block still
+ * queued for reclamation is taken off the queue, the pool can not be
+ * used with interrupts disabled, so the memory it holds stays in its
+ * list and is reclaimed when the new thread is deleted.
  */
 UTIL_UNSAFE
 void thd_create_static(thd_cblk_t *p_thd, uint_t prio, void *p_stack,
 		uint_t stack_size, void (*p_job)(void), sch_cblk_t *p_sch)
 {
+	mlst_t mlst;
+	bool_t zombie;
+
 	/*
 	 * If failed:
 	 * Invalid parameters
@@ -795,7 +936,21 @@ void thd_create_static(thd_cblk_t *p_thd, uint_t prio, void *p_stack,
 	UTIL_ASSERT(p_job != NULL);
 	UTIL_ASSERT(prio < OSPORT_NUM_PRIOS);
 
+	zombie = (p_thd->state == THD_STATE_DELETED) &&
+			(p_thd->item_sch.p_q == &p_sch->q_zombie);
+
+	/* blocks in the list point back to it, it must survive thd_init */
+	if( zombie )
+	{
+		sch_qitem_remove( &p_thd->item_sch );
+		mlst = p_thd->mlst;
+	}
+
 	thd_init(p_thd, prio, p_stack, stack_size, p_job, thd_return_hook_static);
+
+	if( zombie )
+		p_thd->mlst = mlst;
+
 	thd_ready( p_thd, p_sch );
 
 	/* only request reschedule when current thread was loaded */
@@ -806,13 +961,13 @@ void thd_create_static(thd_cblk_t *p_thd, uint_t prio, void *p_stack,
 }
 
 /*
- * Delete a static thread
+ * Delete a static thread, the thread is queued for its memory to be
+ * reclaimed on the next pool unlock, which must not happen here with
+ * interrupts disabled
  */
 UTIL_UNSAFE
 void thd_delete_static(thd_cblk_t *p_thd, sch_cblk_t *p_sch)
 {
-	mblk_t *p_mblk;
-
 	/*
 	 * If failed:
 	 * Invalid parameters
@@ -836,15 +991,12 @@ void thd_delete_static(thd_cblk_t *p_thd, sch_cblk_t *p_sch)
 	if( p_thd->item_delay.p_q != NULL )
 		sch_qitem_remove( &p_thd->item_delay );
 
-	/* release memory */
-	while( p_thd->mlst.p_head != NULL )
-	{
-		p_mblk = p_thd->mlst.p_head;
-		mlst_remove( p_mblk );
-		mpool_insert( p_mblk, &g_mpool );
-	}
-
+	thd_remove_wait_items( p_thd );
 	p_thd->p_schinfo = NULL;
+	p_thd->p_timeout = NULL;
+
+	/* queue for memory reclamation */
+	sch_qitem_enq_fifo( &p_thd->item_sch, &p_sch->q_zombie );
 
 	if( p_thd == p_sch->p_current )
 	{
@@ -852,6 +1004,58 @@ void thd_delete_static(thd_cblk_t *p_thd, sch_cblk_t *p_sch)
 	}
 }
 
+/*
+ * Release the memory of deleted threads, except for the current thread
+ * which is still running on its stack. The pool must be locked.
+ */
+UTIL_UNSAFE
+void thd_reclaim(sch_cblk_t *p_sch, mpool_t *p_mpool)
+{
+	sch_qitem_t *p_item;
+	thd_cblk_t *p_thd;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_sch != NULL );
+	UTIL_ASSERT( p_mpool != NULL );
+
+	do
+	{
+		p_thd = NULL;
+
+		UTIL_LOCK_EVERYTHING();
+
+		p_item = p_sch->q_zombie.p_head;
+
+		/* skip current thread, only one deleted thread can be current */
+		if( (p_item != NULL) && (p_item->p_thd == p_sch->p_current) )
+		{
+			p_item = p_item->p_next;
+
+			if( p_item == p_sch->q_zombie.p_head )
+				p_item = NULL;
+		}
+
+		if( p_item != NULL )
+		{
+			p_thd = p_item->p_thd;
+			sch_qitem_remove( p_item );
+		}
+
+		UTIL_UNLOCK_EVERYTHING();
+
+		/*
+		 * release memory with interrupts enabled, the control block
+		 * and stack of a dynamic thread are in its own memory list
+		 */
+		if( p_thd != NULL )
+			mpool_reclaim( &p_thd->mlst, p_mpool );
+
+	} while( p_thd != NULL );
+}
+
 /*
  * Static threads return here
  */
@@ -922,35 +1126,63 @@ os_handle_t os_thread_create( os_uint_t prio, os_uint_t stack_size, void (*p_job
 	UTIL_ASSERT( prio < OSPORT_NUM_PRIOS - 1 );
 
 	/* allocate memory */
-	UTIL_LOCK_EVERYTHING();
-	p_stack = mpool_alloc( stack_size, &g_mpool, &g_mlst );
-
-	if( p_stack != NULL )
+	if( mpool_lock( &g_mpool, &g_sch ) )
 	{
-		p_thd = (thd_cblk_t*)mpool_alloc( sizeof(thd_cblk_t), &g_mpool, &g_mlst );
+		p_stack = mpool_alloc( stack_size, &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
 
-		if( p_thd == NULL )
-			mpool_free(p_stack, &g_mpool);
-		else
+		if( p_stack != NULL )
 		{
-			thd_init( p_thd, prio, p_stack, stack_size, p_job, thd_return_hook );
-			thd_ready( p_thd, &g_sch );
+			p_thd = (thd_cblk_t*)mpool_alloc( sizeof(thd_cblk_t), &g_mpool, &g_mlst,
+					MPOOL_LONG_LIVED );
 
-			/* only request reschedule when current thread was loaded */
-			if( g_sch.p_current != NULL )
+			if( p_thd == NULL )
+				mpool_free(p_stack, &g_mpool);
+			else
 			{
-				sch_reschedule_req(&g_sch);
+				MPOOL_TAG( p_stack, OSPORT_CALLER_ADDRESS() );
+				MPOOL_TAG( p_thd, OSPORT_CALLER_ADDRESS() );
+
+				/* not visible to the scheduler yet */
+				thd_init( p_thd, prio, p_stack, stack_size, p_job, thd_return_hook );
+
+				/* the thread owns its control block and stack */
+				if( mpool_transfer( p_stack, &p_thd->mlst ) )
+					mpool_transfer( p_thd, &p_thd->mlst );
+				else
+				{
+					mpool_free( p_stack, &g_mpool );
+					mpool_free( p_thd, &g_mpool );
+					p_thd = NULL;
+				}
 			}
 		}
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	if( p_thd != NULL )
+	{
+		UTIL_LOCK_EVERYTHING();
+		thd_ready( p_thd, &g_sch );
+
+		/* only request reschedule when current thread was loaded */
+		if( g_sch.p_current != NULL )
+		{
+			sch_reschedule_req(&g_sch);
+		}
+
+		UTIL_UNLOCK_EVERYTHING();
 	}
 
-	UTIL_UNLOCK_EVERYTHING();
 	return (os_handle_t)p_thd;
 }
 
 /**
  * @brief Delete a thread, free all memory
  * @param h_thread thread handle
+ * @details The memory is released with interrupts enabled. When a thread
+ * deletes itself, or an interrupt deletes a thread while the memory pool
+ * is in use, the memory is released by the next memory operation.
  * @note This function is thread safe and can be used in thread
  * or interrupt context.
  */
@@ -958,7 +1190,6 @@ UTIL_SAFE
 void os_thread_delete( os_handle_t h_thread )
 {
 	thd_cblk_t *p_thd;
-	mblk_t *p_mblk;
 
 	UTIL_LOCK_EVERYTHING();
 
@@ -973,6 +1204,18 @@ void os_thread_delete( os_handle_t h_thread )
 	 */
 	UTIL_ASSERT(p_thd != NULL);
 
+	/*
+	 * If failed:
+	 * Thread killed twice
+	 */
+	UTIL_ASSERT( p_thd->state != THD_STATE_DELETED );
+
+	/*
+	 * If failed:
+	 * stack lost
+	 */
+	UTIL_ASSERT( p_thd->p_stack != NULL );
+
 	p_thd->state = THD_STATE_DELETED;
 
 	/* remove scheduling item */
@@ -983,25 +1226,12 @@ void os_thread_delete( os_handle_t h_thread )
 	if( p_thd->item_delay.p_q != NULL )
 		sch_qitem_remove( &p_thd->item_delay );
 
-	/* release memory */
-	while( p_thd->mlst.p_head != NULL )
-	{
-		p_mblk = p_thd->mlst.p_head;
-		mlst_remove( p_mblk );
-		mpool_insert( p_mblk, &g_mpool );
-	}
-
+	thd_remove_wait_items( p_thd );
 	p_thd->p_schinfo = NULL;
+	p_thd->p_timeout = NULL;
 
-	/*
-	 * If failed:
-	 * stack lost
-	 */
-	UTIL_ASSERT( p_thd->p_stack != NULL );
-
-	/* free memory */
-	mpool_free(p_thd->p_stack, &g_mpool);
-	mpool_free(p_thd, &g_mpool);
+	/* queue for memory reclamation */
+	sch_qitem_enq_fifo( &p_thd->item_sch, &g_sch.q_zombie );
 
 	if( p_thd == g_sch.p_current )
 	{
@@ -1009,6 +1239,10 @@ void os_thread_delete( os_handle_t h_thread )
 	}
 
 	UTIL_UNLOCK_EVERYTHING();
+
+	/* memory is reclaimed on unlock, or later when the pool is in use */
+	if( mpool_lock( &g_mpool, &g_sch ) )
+		mpool_unlock( &g_mpool, &g_sch );
 }
 
 /*
@@ -1182,7 +1416,9 @@ void os_thread_suspend( os_handle_t h_thread )
 			sch_qitem_remove( &p_thd->item_delay );
 
 		/* remove scheduling info */
+		thd_remove_wait_items( p_thd );
 		p_thd->p_schinfo = NULL;
+		p_thd->p_timeout = NULL;
 
 		if( p_thd == g_sch.p_current )
 		{
@@ -1240,6 +1476,7 @@ void os_thread_set_priority( os_handle_t h_thread, os_uint_t prio )
 {
 	thd_cblk_t *p_thd;
 	sch_qprio_t *p_qprio;
+	uint_t i;
 
 	/*
 	 * If failed:
@@ -1257,6 +1494,11 @@ void os_thread_set_priority( os_handle_t h_thread, os_uint_t prio )
 	switch( p_thd->state )
 	{
 	case THD_STATE_DELETED:
+		/* scheduling item might be waiting for memory reclamation */
+		p_thd->item_sch.tag = prio;
+
+		break;
+
 	case THD_STATE_SUSPENDED:
 		/*
 		 * If failed:
@@ -1292,6 +1534,20 @@ void os_thread_set_priority( os_handle_t h_thread, os_uint_t prio )
 		if(p_qprio != NULL )
 			sch_qitem_enq_prio( &p_thd->item_sch, p_qprio);
 
+		/* reorder every wait queue of a thread waiting on several objects */
+		for( i = 0; i < p_thd->num_wait_items; i++ )
+		{
+			p_qprio = p_thd->p_wait_items[i].p_q;
+
+			if( p_qprio != NULL )
+				sch_qitem_remove( &p_thd->p_wait_items[i] );
+
+			p_thd->p_wait_items[i].tag = prio;
+
+			if( p_qprio != NULL )
+				sch_qitem_enq_prio( &p_thd->p_wait_items[i], p_qprio );
+		}
+
 		break;
 
 	default:
@@ -0,0 +1,361 @@
+/** ************************************************************************
+ * @file topic.c
+ * @brief Publish/subscribe topic
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#include "../include/topic.h"
+#include "../include/global.h"
+#include "../include/api.h"
+
+/*
+ * Initialize topic
+ */
+UTIL_UNSAFE
+void topic_init( topic_cblk_t *p_topic )
+{
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_topic
+	 */
+	UTIL_ASSERT( p_topic != NULL );
+
+	p_topic->p_subs = NULL;
+}
+
+/*
+ * Add a subscriber queuing up to count messages in p_buffer
+ */
+UTIL_UNSAFE
+void topic_subscribe( topic_cblk_t *p_topic, topic_sub_t *p_sub, void *p_buffer, uint_t count )
+{
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_topic or p_sub
+	 */
+	UTIL_ASSERT( p_topic != NULL );
+	UTIL_ASSERT( p_sub != NULL );
+
+	msgq_init( &p_sub->msgq, p_buffer, sizeof(void*), count );
+
+	p_sub->p_topic = p_topic;
+	p_sub->p_next = p_topic->p_subs;
+	p_topic->p_subs = p_sub;
+}
+
+/*
+ * Remove a subscriber, threads waiting on it are readied and messages
+ * still queued are left for the caller to release
+ */
+UTIL_UNSAFE
+void topic_unsubscribe( topic_sub_t *p_sub, sch_cblk_t *p_sch )
+{
+	topic_sub_t *volatile *pp_link;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_sub, or not subscribed
+	 */
+	UTIL_ASSERT( p_sub != NULL );
+	UTIL_ASSERT( p_sub->p_topic != NULL );
+
+	pp_link = &p_sub->p_topic->p_subs;
+	while( *pp_link != p_sub )
+	{
+		/*
+		 * If failed:
+		 * Subscriber missing from its topic
+		 */
+		UTIL_ASSERT( *pp_link != NULL );
+		pp_link = &(*pp_link)->p_next;
+	}
+
+	*pp_link = p_sub->p_next;
+	p_sub->p_next = NULL;
+	p_sub->p_topic = NULL;
+
+	msgq_delete_static( &p_sub->msgq, p_sch );
+}
+
+/*
+ * Queue a message to every subscriber with room for it in a single
+ * pass, returns the number of subscribers it was delivered to
+ */
+UTIL_UNSAFE
+uint_t topic_publish( topic_cblk_t *p_topic, void *p_msg, sch_cblk_t *p_sch )
+{
+	topic_sub_t *p_sub;
+	topic_msg_t *p_hdr;
+	uint_t ret = 0;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( p_topic != NULL );
+	UTIL_ASSERT( p_msg != NULL );
+	UTIL_ASSERT( p_sch != NULL );
+
+	p_hdr = TOPIC_MSG_HEADER( p_msg );
+
+	for( p_sub = p_topic->p_subs; p_sub != NULL; p_sub = p_sub->p_next )
+	{
+		/* a full subscriber misses the message */
+		if( p_sub->msgq.count < p_sub->msgq.item_count )
+		{
+			p_hdr->refs++;
+			msgq_write( &p_sub->msgq, (const byte_t*)&p_msg );
+			msgq_unlock_threads( &p_sub->msgq, p_sch );
+			ret++;
+		}
+	}
+
+	return ret;
+}
+
+UTIL_SAFE
+os_handle_t os_topic_create( void )
+{
+	topic_cblk_t *p_topic = NULL;
+
+	if( mpool_lock( &g_mpool, &g_sch ) )
+	{
+		p_topic = mpool_alloc( sizeof(topic_cblk_t), &g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+		if( p_topic != NULL )
+			MPOOL_TAG( p_topic, OSPORT_CALLER_ADDRESS() );
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	if( p_topic != NULL )
+	{
+		UTIL_LOCK_EVERYTHING();
+		topic_init( p_topic );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return (os_handle_t)p_topic;
+}
+
+UTIL_SAFE
+void os_topic_delete( os_handle_t h_topic )
+{
+	topic_cblk_t *p_topic;
+	p_topic = (topic_cblk_t*)h_topic;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_topic
+	 */
+	UTIL_ASSERT( p_topic != NULL );
+
+	/* subscriber handles are invalid afterwards */
+	while( p_topic->p_subs != NULL )
+		os_topic_unsubscribe( (os_handle_t)p_topic->p_subs );
+
+	mpool_lock_free( p_topic, &g_mpool, &g_sch );
+}
+
+UTIL_SAFE
+os_handle_t os_topic_subscribe( os_handle_t h_topic, os_uint_t count )
+{
+	topic_cblk_t *p_topic;
+	topic_sub_t *p_sub = NULL;
+	p_topic = (topic_cblk_t*)h_topic;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_topic
+	 */
+	UTIL_ASSERT( p_topic != NULL );
+
+	/* message slots follow the subscriber, written to avoid overflowing on large requests */
+	if( (count <= (MPOOL_SIZE_MAX - sizeof(topic_sub_t)) / sizeof(void*)) &&
+			mpool_lock( &g_mpool, &g_sch ) )
+	{
+		p_sub = mpool_alloc( sizeof(topic_sub_t) + count * sizeof(void*),
+				&g_mpool, &g_mlst, MPOOL_LONG_LIVED );
+
+		if( p_sub != NULL )
+			MPOOL_TAG( p_sub, OSPORT_CALLER_ADDRESS() );
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	if( p_sub != NULL )
+	{
+		UTIL_LOCK_EVERYTHING();
+		topic_subscribe( p_topic, p_sub, p_sub + 1, count );
+		UTIL_UNLOCK_EVERYTHING();
+	}
+
+	return (os_handle_t)p_sub;
+}
+
+UTIL_SAFE
+void os_topic_unsubscribe( os_handle_t h_sub )
+{
+	topic_sub_t *p_sub;
+	void *p_msg;
+	p_sub = (topic_sub_t*)h_sub;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_sub
+	 */
+	UTIL_ASSERT( p_sub != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	topic_unsubscribe( p_sub, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+
+	/* drop the references of messages never received */
+	while( p_sub->msgq.count != 0 )
+	{
+		msgq_read( &p_sub->msgq, (byte_t*)&p_msg );
+		os_topic_release( p_msg );
+	}
+
+	mpool_lock_free( p_sub, &g_mpool, &g_sch );
+}
+
+UTIL_SAFE
+void *os_topic_alloc( os_uint_t size )
+{
+	topic_msg_t *p_hdr = NULL;
+	void *p_ret = NULL;
+
+	/* shared by subscribers, so owned by the kernel */
+	if( (size <= MPOOL_SIZE_MAX - TOPIC_MSG_HEADER_SIZE) && mpool_lock( &g_mpool, &g_sch ) )
+	{
+		p_hdr = mpool_alloc( TOPIC_MSG_HEADER_SIZE + size, &g_mpool, &g_mlst, MPOOL_TRANSIENT );
+
+		if( p_hdr != NULL )
+			MPOOL_TAG( p_hdr, OSPORT_CALLER_ADDRESS() );
+
+		mpool_unlock( &g_mpool, &g_sch );
+	}
+
+	if( p_hdr != NULL )
+	{
+		/* reference of the publisher */
+		p_hdr->refs = 1;
+		p_ret = (byte_t*)p_hdr + TOPIC_MSG_HEADER_SIZE;
+	}
+
+	return p_ret;
+}
+
+UTIL_SAFE
+os_uint_t os_topic_publish( os_handle_t h_topic, void *p_msg )
+{
+	topic_cblk_t *p_topic;
+	uint_t ret;
+	p_topic = (topic_cblk_t*)h_topic;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_topic or p_msg
+	 */
+	UTIL_ASSERT( p_topic != NULL );
+	UTIL_ASSERT( p_msg != NULL );
+
+	UTIL_LOCK_EVERYTHING();
+	ret = topic_publish( p_topic, p_msg, &g_sch );
+	UTIL_UNLOCK_EVERYTHING();
+
+	/* the publisher hands its reference over */
+	os_topic_release( p_msg );
+
+	return ret;
+}
+
+UTIL_SAFE
+void *os_topic_receive( os_handle_t h_sub, os_uint_t timeout )
+{
+	topic_sub_t *p_sub;
+	void *p_ret = NULL;
+	p_sub = (topic_sub_t*)h_sub;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_sub
+	 */
+	UTIL_ASSERT( p_sub != NULL );
+
+	if( !os_msgq_receive( (os_handle_t)&p_sub->msgq, &p_ret, timeout ) )
+		p_ret = NULL;
+
+	return p_ret;
+}
+
+UTIL_SAFE
+void *os_topic_receive_nb( os_handle_t h_sub )
+{
+	topic_sub_t *p_sub;
+	void *p_ret = NULL;
+	p_sub = (topic_sub_t*)h_sub;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_sub
+	 */
+	UTIL_ASSERT( p_sub != NULL );
+
+	if( !os_msgq_receive_nb( (os_handle_t)&p_sub->msgq, &p_ret ) )
+		p_ret = NULL;
+
+	return p_ret;
+}
+
+UTIL_SAFE
+void os_topic_release( void *p_msg )
+{
+	topic_msg_t *p_hdr;
+	bool_t last;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_msg
+	 */
+	UTIL_ASSERT( p_msg != NULL );
+
+	p_hdr = TOPIC_MSG_HEADER( p_msg );
+
+	UTIL_LOCK_EVERYTHING();
+
+	/*
+	 * If failed:
+	 * Message released more often than received
+	 */
+	UTIL_ASSERT( p_hdr->refs != 0 );
+
+	p_hdr->refs--;
+	last = (p_hdr->refs == 0);
+	UTIL_UNLOCK_EVERYTHING();
+
+	if( last )
+		mpool_lock_free( p_hdr, &g_mpool, &g_sch );
+}
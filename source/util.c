@@ -25,6 +25,7 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *****************************************************************************/
+#include <string.h>
 #include "../include/util.h"
 #include "../include/thread.h"
 #include "../include/global.h"
@@ -45,3 +46,72 @@ void util_eint_nested( void )
 	sch_unlock_int(&g_sch);
 }
 
+/*
+ * Word copied by util_copy. Caller buffers of any type are accessed
+ * through it, so the port may provide a word type exempt from strict
+ * aliasing. Otherwise each word is copied with a fixed-size memcpy,
+ * which the compiler turns into a single load and store.
+ */
+#if defined(OSPORT_ALIAS_WORD_T)
+typedef OSPORT_ALIAS_WORD_T util_word_t;
+#	define UTIL_COPY_WORD(P_DST, P_SRC) \
+		(*(util_word_t*)(P_DST) = *(const util_word_t*)(P_SRC))
+#else
+typedef handle_t util_word_t;
+#	define UTIL_COPY_WORD(P_DST, P_SRC) \
+		memcpy( (P_DST), (P_SRC), sizeof(util_word_t) )
+#endif
+
+/*
+ * Copies shorter than this skip the alignment check, a byte loop
+ * costs less than setting up the word loops
+ */
+#define UTIL_COPY_SHORT (2*sizeof(util_word_t))
+
+/*
+ * Copy memory, a word at a time when source and destination
+ * share the same word alignment. The regions must not overlap.
+ */
+void util_copy( void *p_dst, const void *p_src, uint_t size )
+{
+	byte_t *p_d = (byte_t*)p_dst;
+	const byte_t *p_s = (const byte_t*)p_src;
+
+	if( (size >= UTIL_COPY_SHORT) &&
+		(((handle_t)p_d % sizeof(util_word_t)) == ((handle_t)p_s % sizeof(util_word_t))) )
+	{
+		/* leading bytes up to the word boundary */
+		while( (size != 0) && ((handle_t)p_d % sizeof(util_word_t) != 0) )
+		{
+			*p_d++ = *p_s++;
+			size--;
+		}
+
+		/* four words per iteration */
+		while( size >= 4*sizeof(util_word_t) )
+		{
+			UTIL_COPY_WORD( p_d, p_s );
+			UTIL_COPY_WORD( p_d + sizeof(util_word_t), p_s + sizeof(util_word_t) );
+			UTIL_COPY_WORD( p_d + 2*sizeof(util_word_t), p_s + 2*sizeof(util_word_t) );
+			UTIL_COPY_WORD( p_d + 3*sizeof(util_word_t), p_s + 3*sizeof(util_word_t) );
+			p_d += 4*sizeof(util_word_t);
+			p_s += 4*sizeof(util_word_t);
+			size -= 4*sizeof(util_word_t);
+		}
+
+		while( size >= sizeof(util_word_t) )
+		{
+			UTIL_COPY_WORD( p_d, p_s );
+			p_d += sizeof(util_word_t);
+			p_s += sizeof(util_word_t);
+			size -= sizeof(util_word_t);
+		}
+	}
+
+	/* trailing bytes, or everything when short or misaligned */
+	while( size != 0 )
+	{
+		*p_d++ = *p_s++;
+		size--;
+	}
+}
@@ -0,0 +1,238 @@
+/** ************************************************************************
+ * @file wait.c
+ * @brief Waiting on several kernel objects
+ * @author John Yu buyi.yu@wne.edu
+ *
+ * This file is part of mRTOS.
+ *
+ * Copyright (C) 2018 John Buyi Yu
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+#include "../include/wait.h"
+#include "../include/msgq.h"
+#include "../include/global.h"
+#include "../include/api.h"
+
+/*
+ * Check if an object can be taken without blocking
+ */
+UTIL_UNSAFE
+bool_t wait_is_ready( uint_t type, handle_t h_object, uint_t size, const sch_cblk_t *p_sch )
+{
+	bool_t ret = false;
+	mutex_cblk_t *p_mutex;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( h_object != 0 );
+	UTIL_ASSERT( p_sch != NULL );
+
+	switch( type )
+	{
+	case WAIT_SEMAPHORE:
+		ret = (((sem_cblk_t*)h_object)->counter != 0);
+		break;
+
+	case WAIT_MUTEX:
+		p_mutex = (mutex_cblk_t*)h_object;
+		ret = (p_mutex->lock_depth == 0) || (p_mutex->p_owner == p_sch->p_current);
+		break;
+
+	case WAIT_QUEUE:
+		ret = (queue_get_used_size( (queue_cblk_t*)h_object ) >= size);
+		break;
+
+	case WAIT_MSGQ:
+		ret = (((msgq_cblk_t*)h_object)->count != 0);
+		break;
+
+	default:
+		/*
+		 * If failed:
+		 * Invalid object type
+		 */
+		UTIL_ASSERT(0);
+		break;
+	}
+
+	return ret;
+}
+
+/*
+ * Initialize peek scheduling info for an object,
+ * returns the wait queue to put the item on
+ */
+UTIL_UNSAFE
+sch_qprio_t *wait_prepare( uint_t type, handle_t h_object, uint_t size, wait_schinfo_t *p_schinfo )
+{
+	sch_qprio_t *p_ret = NULL;
+
+	/*
+	 * If failed:
+	 * Invalid parameters
+	 */
+	UTIL_ASSERT( h_object != 0 );
+	UTIL_ASSERT( p_schinfo != NULL );
+
+	switch( type )
+	{
+	case WAIT_SEMAPHORE:
+		sem_schinfo_init( &p_schinfo->sem, SEM_PEEK );
+		p_ret = &((sem_cblk_t*)h_object)->q_wait;
+		break;
+
+	case WAIT_MUTEX:
+		mutex_schinfo_init( &p_schinfo->mutex, MUTEX_PEEK );
+		p_ret = &((mutex_cblk_t*)h_object)->q_wait;
+		break;
+
+	case WAIT_QUEUE:
+		queue_schinfo_read_init( &p_schinfo->queue, QUEUE_READ_PEEK );
+		p_schinfo->queue.p_data = NULL;
+		p_schinfo->queue.size = size;
+		p_ret = &((queue_cblk_t*)h_object)->q_wait_read;
+		break;
+
+	case WAIT_MSGQ:
+		queue_schinfo_read_init( &p_schinfo->queue, QUEUE_READ_PEEK );
+		p_schinfo->queue.p_data = NULL;
+		p_schinfo->queue.size = ((msgq_cblk_t*)h_object)->item_size;
+		p_ret = &((msgq_cblk_t*)h_object)->q_wait_read;
+		break;
+
+	default:
+		/*
+		 * If failed:
+		 * Invalid object type
+		 */
+		UTIL_ASSERT(0);
+		break;
+	}
+
+	return p_ret;
+}
+
+/*
+ * Check if the object of a wait item readied the thread
+ */
+UTIL_UNSAFE
+bool_t wait_get_result( uint_t type, const wait_schinfo_t *p_schinfo )
+{
+	bool_t ret = false;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_schinfo
+	 */
+	UTIL_ASSERT( p_schinfo != NULL );
+
+	switch( type )
+	{
+	case WAIT_SEMAPHORE:
+		ret = p_schinfo->sem.result;
+		break;
+
+	case WAIT_MUTEX:
+		ret = p_schinfo->mutex.result;
+		break;
+
+	case WAIT_QUEUE:
+	case WAIT_MSGQ:
+		ret = p_schinfo->queue.result;
+		break;
+
+	default:
+		/*
+		 * If failed:
+		 * Invalid object type
+		 */
+		UTIL_ASSERT(0);
+		break;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Waits until one of several objects becomes available
+ * @param p_objects the objects to wait on
+ * @param num number of objects, at most OSPORT_WAIT_MAX_OBJECTS
+ * @param timeout Sleep timeout, pass 0 for infinite
+ * @return index of the first available object, or num on timeout
+ * or when an object was deleted
+ * @details The calling thread is queued on the wait list of every
+ * object at once, as if peeking each of them. No object is taken:
+ * call the nonblocking function of the returned object, which may
+ * fail if another thread took the object first.
+ * @note This function can only be used in a thread context.
+ */
+UTIL_SAFE
+os_uint_t os_wait_any( const os_wait_object_t *p_objects, os_uint_t num, os_uint_t timeout )
+{
+	sch_qitem_t items[OSPORT_WAIT_MAX_OBJECTS];
+	wait_schinfo_t schinfo[OSPORT_WAIT_MAX_OBJECTS];
+	thd_cblk_t *p_thd;
+	uint_t i, ret;
+
+	/*
+	 * If failed:
+	 * NULL pointer passed to p_objects, or invalid number of objects
+	 */
+	UTIL_ASSERT( p_objects != NULL );
+	UTIL_ASSERT( (num != 0) && (num <= OSPORT_WAIT_MAX_OBJECTS) );
+
+	UTIL_LOCK_EVERYTHING();
+
+	/* first object available now */
+	ret = 0;
+	while( (ret < num) && !wait_is_ready( p_objects[ret].type,
+			p_objects[ret].h_object, p_objects[ret].size, &g_sch ) )
+		ret++;
+
+	if( ret == num )
+	{
+		p_thd = g_sch.p_current;
+
+		/* one item per object, ordered by thread priority */
+		for( i = 0; i < num; i++ )
+		{
+			sch_qitem_init( &items[i], p_thd, p_thd->item_sch.tag );
+			items[i].p_schinfo = &schinfo[i];
+			sch_qitem_enq_prio( &items[i], wait_prepare( p_objects[i].type,
+					p_objects[i].h_object, p_objects[i].size, &schinfo[i] ) );
+		}
+
+		p_thd->p_wait_items = items;
+		p_thd->num_wait_items = num;
+
+		/* readied by any object removes all items */
+		thd_block_current( NULL, schinfo, timeout, &g_sch );
+
+		ret = 0;
+		while( (ret < num) && !wait_get_result( p_objects[ret].type, &schinfo[ret] ) )
+			ret++;
+	}
+
+	UTIL_UNLOCK_EVERYTHING();
+
+	return ret;
+}